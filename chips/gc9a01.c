@@ -7,16 +7,44 @@
 // only if its (x,y) lies inside a centered circle; otherwise the pixel is forced black.
 //
 // Compatible with the Adafruit_GC9A01A library.
+//
+// Attributes (set in diagram.json):
+//   refresh_rate    Panel refresh rate in Hz (default 60)
+//   stats_interval  Print performance counters every N ms of sim time (0 = off)
+//   overdraw_heatmap  1 = show how often each pixel was written per refresh
+//                     instead of the image (can be toggled while running)
+//   opcode_interval Print the per-opcode command table every N ms (0 = off)
+//   dump_opcodes    Print the per-opcode command table whenever this changes
+//   trace           1 = stream a binary SPI/pin event trace out of the TRACE
+//                   pin (format in gc9a01_trace.h)
+//   trace_baud      TRACE pin baud rate (default 100000000). The trace carries
+//                   every SPI byte, so it needs about 2.5x the SPI clock;
+//                   slower rates drop records (and warn)
+//   frame_crc       1 = print a CRC32 of the presented framebuffer for every
+//                   frame that changed it, and at DISPON (also included in the
+//                   stats report)
+//   dead_writes     1 = count pixels overwritten before they were ever
+//                   presented, per refresh and per region (in the stats report)
+//   slice_pixels    Pixels a presentation may handle per callback (rows it
+//                   blanks after a reset count too) before it continues 1 ms
+//                   later (default 14400, a quarter of the panel; 0 = no
+//                   limit, every presentation in one callback)
 // 
 // SPDX-License-Identifier: MIT
 // (c) 2025 CodeMagic LTD
 
 #include "wokwi-api.h"
+#include "gc9a01_trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /*-----------------------------------------------------------
    GC9A01 Command Codes
@@ -33,6 +61,82 @@
 #define GC9A01_INVOFF   0x20   // Inversion OFF
 #define GC9A01_INVON    0x21   // Inversion ON
 
+/*-----------------------------------------------------------
+   SPI receive buffer size. Larger buffers mean fewer spi_done
+   callbacks and longer pixel bursts per callback.
+-----------------------------------------------------------*/
+#define GC9A01_SPI_BUFFER_SIZE  4096
+
+/*-----------------------------------------------------------
+   Default panel refresh rate. Pixel writes are collected in a
+   shadow framebuffer and presented to the simulator once per frame.
+-----------------------------------------------------------*/
+#define GC9A01_DEFAULT_REFRESH_RATE  60   // Hz
+
+/*-----------------------------------------------------------
+   Changed runs separated by fewer unchanged pixels than this are
+   presented with a single buffer_write.
+-----------------------------------------------------------*/
+#define GC9A01_PRESENT_GAP  8
+
+/*-----------------------------------------------------------
+   Number of windows kept in the masked-area waste report.
+-----------------------------------------------------------*/
+#define GC9A01_WORST_WINDOWS  4
+
+/*-----------------------------------------------------------
+   Bus timeline histograms use power-of-two buckets: bucket 0 holds
+   zero, bucket n holds [2^(n-1), 2^n), the last bucket everything above.
+-----------------------------------------------------------*/
+#define GC9A01_HISTOGRAM_BUCKETS  20
+
+/*-----------------------------------------------------------
+   RAMWR windows are classified by area (pixels) to compare window
+   setup overhead with pixel payload: 1, 2-15, 16-255, 256-4095 and
+   4096+ pixels, plus a bucket for invalid windows (start > end).
+-----------------------------------------------------------*/
+#define GC9A01_AREA_BUCKETS  6
+
+/*-----------------------------------------------------------
+   Protocol violations: bus traffic the chip had to discard or that
+   shows a driver bug. Each kind is warned about at most once per
+   GC9A01_WARNING_INTERVAL_NS of sim time.
+-----------------------------------------------------------*/
+typedef enum {
+  GC9A01_VIOLATION_STRAY_DATA,  // Data bytes no command parameter or RAMWR can take
+  GC9A01_VIOLATION_ODD_BYTE,    // Half a pixel left over when CS rose
+  GC9A01_VIOLATION_OVERRUN,     // RAMWR pixels past the end of the window (wrapped)
+  GC9A01_VIOLATION_NO_WINDOW,   // RAMWR before any CASET/RASET
+  GC9A01_VIOLATIONS
+} gc9a01_violation_t;
+
+#define GC9A01_WARNING_INTERVAL_NS  1000000000ull
+
+/*-----------------------------------------------------------
+   Dead writes are reported per region of a GC9A01_DEAD_GRID x
+   GC9A01_DEAD_GRID grid over the panel.
+-----------------------------------------------------------*/
+#define GC9A01_DEAD_GRID  4
+
+/*-----------------------------------------------------------
+   Event trace: records are batched into buffers of this size, one
+   being sent over the TRACE UART while the other fills. At 10 bits
+   per byte the default rate keeps up with a 40 MHz SPI bus.
+-----------------------------------------------------------*/
+#define GC9A01_TRACE_BUFFER_SIZE   32768
+#define GC9A01_DEFAULT_TRACE_BAUD  100000000
+
+/*-----------------------------------------------------------
+   Callback work budget: presenting a frame (including filling rows
+   left stale by a reset) is done in slices of at most slice_pixels
+   pixels per callback (default below, 0 = no limit), continued every
+   GC9A01_SLICE_NS on the slice timer.
+-----------------------------------------------------------*/
+#define GC9A01_DEFAULT_SLICE_PIXELS  14400     // A quarter of the panel
+#define GC9A01_SLICE_NS              1000000   // 1 ms
+
+#define GC9A01_BLACK  0xff000000
+
 /*-----------------------------------------------------------
    SPI Mode: Command vs Data
 -----------------------------------------------------------*/
@@ -41,6 +145,69 @@ typedef enum {
   GC9A01_MODE_DATA
 } gc9a01_mode_t;
 
+/*-----------------------------------------------------------
+   Performance counters (reported every stats_interval ms)
+-----------------------------------------------------------*/
+typedef struct {
+  uint64_t bytes_received;      // SPI bytes delivered to gc9a01_spi_done()
+  uint64_t pixels_written;      // RAMWR pixels received
+  uint32_t commands[256];       // Command bytes by opcode
+  uint32_t spi_done_calls;
+  uint32_t buffer_writes;       // Host buffer_write() calls
+  uint32_t frames;              // Refreshes that changed the simulator framebuffer
+  uint32_t redundant_commands;  // Commands that repeated the current register values
+  uint32_t redundant_bytes;     // ... including their parameter bytes
+  uint64_t masked_pixels;       // RAMWR pixels never shown (outside the circle, off-panel
+                                // or in an invalid window)
+
+  /* Bus timeline: CS-low transactions and the idle gaps between them */
+  uint32_t transactions;
+  uint64_t cs_low_ns;                                   // Total time with CS low
+  uint32_t cs_low_us[GC9A01_HISTOGRAM_BUCKETS];         // CS-low duration (us)
+  uint32_t cs_gap_us[GC9A01_HISTOGRAM_BUCKETS];         // CS-high gap before a transaction (us)
+  uint32_t transaction_bytes[GC9A01_HISTOGRAM_BUCKETS]; // Bytes per transaction
+
+  /* Window overhead: RAMWR windows by area, the CASET/RASET/RAMWR bytes
+     (with parameters) spent setting them up and their pixel payload */
+  uint32_t windows[GC9A01_AREA_BUCKETS];
+  uint64_t window_overhead_bytes[GC9A01_AREA_BUCKETS];
+  uint64_t window_payload_bytes[GC9A01_AREA_BUCKETS];
+
+  /* Protocol violations and the bus bytes they wasted */
+  uint32_t violations[GC9A01_VIOLATIONS];
+  uint64_t violation_bytes[GC9A01_VIOLATIONS];
+
+  /* Dead writes: pixels overwritten before they were presented, in
+     total and per region */
+  uint64_t counted_writes;
+  uint64_t dead_writes;
+  uint64_t dead_regions[GC9A01_DEAD_GRID * GC9A01_DEAD_GRID];
+} gc9a01_stats_t;
+
+/*-----------------------------------------------------------
+   Per-opcode command table: how often each command was sent, the bus
+   bytes it used (command byte, parameters and RAMWR pixel data) and
+   the sim time from the command byte to the end of its data phase.
+-----------------------------------------------------------*/
+typedef struct {
+  uint32_t count;
+  uint64_t bytes;
+  uint64_t latency_ns;
+  uint64_t max_latency_ns;
+} gc9a01_opcode_stats_t;
+
+/*-----------------------------------------------------------
+   Pixels received for one address window (one RAMWR data phase)
+-----------------------------------------------------------*/
+typedef struct {
+  uint16_t col_start;
+  uint16_t col_end;
+  uint16_t row_start;
+  uint16_t row_end;
+  uint32_t pixels;
+  uint32_t masked;
+} gc9a01_window_stats_t;
+
 /*-----------------------------------------------------------
    GC9A01 State Structure
 -----------------------------------------------------------*/
@@ -50,7 +217,7 @@ typedef struct {
   pin_t cs_pin;
   pin_t dc_pin;
   pin_t rst_pin;
-  uint8_t spi_buffer[256]; // Added SPI buffer for receiving SPI data packets
+  uint8_t spi_buffer[GC9A01_SPI_BUFFER_SIZE]; // SPI buffer for receiving SPI data packets
 
   /* Display framebuffer and dimensions */
   buffer_t framebuffer;
@@ -64,6 +231,8 @@ typedef struct {
   uint8_t expected_args;
   uint8_t received_args;
   uint8_t command_args[16];  // Buffer for command parameters
+  bool unmodelled_params;    // current_command is not modelled: any data up to
+                             // the next command byte is its parameters
 
   /* Data mode: pending byte when receiving 16-bit pixel data */
   uint8_t pending_data;
@@ -77,17 +246,147 @@ typedef struct {
   uint16_t current_col;
   uint16_t current_row;
 
+  /* Address window clipped to the panel once per CASET/RASET:
+     window_valid is false for inverted ranges (start > end), and only
+     columns <= vis_col_end on rows <= vis_row_end reach the framebuffer.
+     The rest of each window row is skipped by advancing the pointer. */
+  bool window_valid;
+  bool window_visible;
+  uint16_t vis_col_end;
+  uint16_t vis_row_end;
+  uint64_t window_area;    // Pixels in the (unclipped) window
+
   /* RAM write flag: true when RAMWR command is active */
   bool ram_write;
+  uint64_t window_written; // Pixels written since RAMWR
+  uint8_t window_set;      // 1 = CASET, 2 = RASET received since reset
+  /* Point write: RAMWR into a visible 1x1 window (drawPixel traffic) */
+  bool point_write;
+
+  /* Shadow framebuffer: RGBA copy of the panel. Pixel writes land here
+     and only the dirty part is sent to the simulator on each refresh. */
+  uint32_t *shadow;
+  uint32_t *presented;     // What the simulator framebuffer currently shows
+  uint16_t *dirty_left;    // Per-row dirty columns [dirty_left, dirty_right],
+  uint16_t *dirty_right;   // dirty_left > dirty_right means the row is clean
+  uint16_t dirty_top;      // Dirty rows [dirty_top, dirty_bottom]
+  uint16_t dirty_bottom;
+  timer_t refresh_timer;
+
+  /* Lazy reset: a reset bumps clear_generation, which makes every row
+     stale (logically black) until it is repainted or materialized.
+     A stale row keeps the one run of columns [cover_left, cover_right]
+     repainted since the reset (cover_left > cover_right = none). */
+  uint32_t clear_generation;
+  uint32_t *row_generation;
+  uint16_t *cover_left;
+  uint16_t *cover_right;
+  uint32_t stale_rows;
+
+  /* Presentation in progress (see run_background), which walks the
+     dirty rows from present_row down in slices */
+  uint32_t slice_pixels;   // Budget per callback, UINT32_MAX = no limit
+  timer_t slice_timer;
+  bool slice_armed;
+  bool presenting;
+  const uint32_t *present_source;
+  uint32_t present_row;
+  uint32_t present_writes; // stats.buffer_writes when the presentation began
+
+  /* Frame CRC: CRC32 of each presented row, refreshed as rows are
+     presented; the row CRCs are combined into the CRC32 of the whole
+     framebuffer */
+  bool crc_enabled;
+  bool crc_pending;        // Print the CRC at the next refresh (DISPON)
+  uint32_t *row_crc;
+  uint32_t row_shift[4][256]; // Appends one row of zero bytes to a CRC, per byte
+
+  /* Rounded mask: visible columns [mask_left, mask_right] per row
+     (mask_left > mask_right means the whole row is masked) */
+  uint16_t *mask_left;
+  uint16_t *mask_right;
 
   /* Other display flags */
   bool display_on;
   bool inverted;  // Inversion flag (INVON/INVOFF)
+  uint8_t madctl; // Memory access control register (MADCTL)
+  uint8_t colmod; // Pixel format register (COLMOD)
+
+  /* Performance counters and the snapshot taken at the last report */
+  gc9a01_stats_t stats;
+  gc9a01_stats_t stats_reported;
+  uint64_t stats_reported_ns;
+  timer_t stats_timer;
+  bool stats_enabled;       // stats_interval is set: only then are CS edges timed
+
+  /* Masked-area waste: the current RAMWR window and the windows that
+     wasted the most pixels since the last report */
+  gc9a01_window_stats_t window_stats;
+  gc9a01_window_stats_t worst_windows[GC9A01_WORST_WINDOWS];
+
+  /* Bus timeline: the current transaction and the longest gap since
+     the last report */
+  bool cs_low;
+  bool cs_seen_high;
+  uint64_t cs_fall_ns;
+  uint64_t cs_rise_ns;
+  uint64_t cs_fall_bytes;
+  uint64_t longest_gap_ns;
+  uint64_t longest_gap_at_ns;
+
+  /* Per-opcode command table; opcode_timing is true while the data
+     phase of current_command is still in progress */
+  gc9a01_opcode_stats_t opcodes[256];
+  bool opcode_timing;
+  uint64_t opcode_start_ns;
+  uint32_t dump_opcodes_attr;
+  uint32_t dump_opcodes_value;
+  timer_t opcode_timer;
+
+  /* Window overhead: area bucket of the current RAMWR window and the
+     setup byte total when it started */
+  uint32_t window_bucket;
+  uint64_t window_setup_mark;
+
+  /* Event trace streamed out of the TRACE pin */
+  bool trace_enabled;
+  bool trace_busy;                // A buffer is being sent over the UART
+  uart_dev_t trace_uart;
+  uint8_t *trace_buffer[2];
+  uint32_t trace_active;          // Buffer being filled
+  uint32_t trace_fill;
+  uint64_t trace_last_ns;         // Timestamp of the last record
+  uint64_t trace_dropped;         // Records dropped since the last overflow record
+  uint64_t trace_warned_ns;       // When dropped records were last warned about
+
+  /* Protocol violation warnings: when each kind was last printed and
+     how many occurrences were not printed since */
+  uint64_t violation_warned_ns[GC9A01_VIOLATIONS];
+  uint32_t violation_suppressed[GC9A01_VIOLATIONS];
+
+  /* Overdraw heatmap: per-pixel write counts for the current refresh
+     interval, rendered into heatmap instead of the image when enabled.
+     The dead-write detector uses the same counts. */
+  uint32_t heatmap_attr;
+  bool heatmap_enabled;
+  bool dead_writes_enabled;
+  bool counting_writes;    // heatmap_enabled || dead_writes_enabled
+  uint8_t *write_counts;
+  uint32_t *heatmap;
+
+  /* Dead writes counted for the presentation in progress */
+  uint64_t dead_pending_written;
+  uint64_t dead_pending;
+  uint64_t dead_pending_regions[GC9A01_DEAD_GRID * GC9A01_DEAD_GRID];
 } gc9a01_state_t;
 
 /*-----------------------------------------------------------
-   Helper: Expected argument count for each command.
+   Helper: Expected argument count for each command. Commands the
+   chip does not model take any number of parameters, up to the next
+   command byte.
 -----------------------------------------------------------*/
+#define GC9A01_ARGS_UNTIL_COMMAND  0xff
+
 static uint8_t get_expected_arg_count(uint8_t command) {
   switch (command) {
     case GC9A01_SWRESET:
@@ -106,7 +405,7 @@ static uint8_t get_expected_arg_count(uint8_t command) {
     case GC9A01_COLMOD:
       return 1;
     default:
-      return 0;
+      return GC9A01_ARGS_UNTIL_COMMAND;
   }
 }
 
@@ -118,6 +417,954 @@ static uint32_t rgb565_to_rgba(uint16_t value) {
   return 0xff000000 | ((value & 0x001F) << 19) | ((value & 0x07E0) << 5) | ((value & 0xF800) >> 8);
 }
 
+/*-----------------------------------------------------------
+   Validate the address window and clip it to the panel.
+   Called whenever CASET/RASET (or a reset) change the window, so
+   the pixel path never has to bounds-check against width/height.
+-----------------------------------------------------------*/
+static void clip_window(gc9a01_state_t *state) {
+  state->window_valid = state->col_start <= state->col_end &&
+                        state->row_start <= state->row_end;
+  state->vis_col_end = state->col_end < state->width  ? state->col_end : state->width - 1;
+  state->vis_row_end = state->row_end < state->height ? state->row_end : state->height - 1;
+  state->window_visible = state->window_valid &&
+                          state->col_start < state->width &&
+                          state->row_start < state->height;
+  state->window_area = state->window_valid ?
+    (uint64_t)(state->col_end - state->col_start + 1) * (state->row_end - state->row_start + 1) : 0;
+}
+
+/*-----------------------------------------------------------
+   Mark columns [left, right] of a row as changed since the last
+   refresh. Clean rows/ranges are stored as (0xffff, 0), so marking
+   is just a min/max.
+-----------------------------------------------------------*/
+static inline void mark_dirty(gc9a01_state_t *state, uint32_t row, uint32_t left, uint32_t right) {
+  if (left < state->dirty_left[row])   state->dirty_left[row] = left;
+  if (right > state->dirty_right[row]) state->dirty_right[row] = right;
+  if (row < state->dirty_top)          state->dirty_top = row;
+  if (row > state->dirty_bottom)       state->dirty_bottom = row;
+}
+
+/*-----------------------------------------------------------
+   Stale rows (lazy reset). A row is only filled with black when it
+   is presented or a write cannot extend its repainted run; a row
+   that gets repainted edge to edge first is never cleared at all,
+   which is what firmware does right after a reset.
+-----------------------------------------------------------*/
+static inline bool row_stale(gc9a01_state_t *state, uint32_t y) {
+  return state->stale_rows > 0 && state->row_generation[y] != state->clear_generation;
+}
+
+static void set_row_current(gc9a01_state_t *state, uint32_t y) {
+  state->row_generation[y] = state->clear_generation;
+  state->stale_rows--;
+}
+
+// Fill what was not repainted since the reset; returns the pixels filled.
+static uint32_t materialize_row(gc9a01_state_t *state, uint32_t y) {
+  uint32_t *row = state->shadow + y * state->width;
+  uint32_t left = state->cover_left[y];
+  uint32_t right = state->cover_right[y];
+  if (left > right) {
+    left = state->width;
+    right = state->width - 1;
+  }
+  for (uint32_t x = 0; x < left; x++) {
+    row[x] = GC9A01_BLACK;
+  }
+  for (uint32_t x = right + 1; x < state->width; x++) {
+    row[x] = GC9A01_BLACK;
+  }
+  set_row_current(state, y);
+  return state->width - (right + 1 - left);
+}
+
+/* Before columns [left, right] of row y are written. */
+static inline void prepare_write(gc9a01_state_t *state, uint32_t y, uint32_t left, uint32_t right) {
+  if (!row_stale(state, y)) {
+    return;
+  }
+  uint16_t *cover_left = &state->cover_left[y];
+  uint16_t *cover_right = &state->cover_right[y];
+  if (*cover_left > *cover_right) {
+    *cover_left = left;
+    *cover_right = right;
+  } else if (left <= (uint32_t)*cover_right + 1 && right + 1 >= *cover_left) {
+    if (left < *cover_left)   *cover_left = left;
+    if (right > *cover_right) *cover_right = right;
+  } else {
+    materialize_row(state, y);
+    return;
+  }
+  if (*cover_left == 0 && *cover_right == state->width - 1) {
+    set_row_current(state, y);
+  }
+}
+
+/*-----------------------------------------------------------
+   Find the first pixel in [i, end) where the shadow framebuffer
+   differs from what was last presented. Unchanged stretches are
+   skipped four pixels at a time where SIMD is available.
+-----------------------------------------------------------*/
+static uint32_t find_change(const uint32_t *shadow, const uint32_t *presented, uint32_t i, uint32_t end) {
+#if defined(__wasm_simd128__)
+  for (; i + 4 <= end; i += 4) {
+    v128_t eq = wasm_i32x4_eq(wasm_v128_load(shadow + i), wasm_v128_load(presented + i));
+    if (!wasm_i32x4_all_true(eq)) {
+      break;
+    }
+  }
+#elif defined(__SSE2__)
+  for (; i + 4 <= end; i += 4) {
+    __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(shadow + i)),
+                                 _mm_loadu_si128((const __m128i *)(presented + i)));
+    if (_mm_movemask_epi8(eq) != 0xffff) {
+      break;
+    }
+  }
+#endif
+  while (i < end && shadow[i] == presented[i]) {
+    i++;
+  }
+  return i;
+}
+
+/*-----------------------------------------------------------
+   Send pixels [offset, offset + count) of source (the shadow
+   framebuffer or the heatmap) to the simulator.
+-----------------------------------------------------------*/
+static void write_framebuffer(gc9a01_state_t *state, const uint32_t *source, uint32_t offset, uint32_t count) {
+  buffer_write(state->framebuffer, offset * 4, (void *)(source + offset), count * 4);
+  state->stats.buffer_writes++;
+}
+
+/*-----------------------------------------------------------
+   CRC32 (IEEE 802.3, as used by zlib), table driven.
+-----------------------------------------------------------*/
+static uint32_t crc_table[256];
+
+static void init_crc_table(void) {
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++) {
+      c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+    }
+    crc_table[n] = c;
+  }
+}
+
+static uint32_t crc32(const void *data, uint32_t len) {
+  const uint8_t *p = data;
+  uint32_t c = 0xffffffff;
+  for (uint32_t i = 0; i < len; i++) {
+    c = crc_table[(c ^ p[i]) & 0xff] ^ (c >> 8);
+  }
+  return c ^ 0xffffffff;
+}
+
+/*-----------------------------------------------------------
+   Frame CRC: only rows that changed since the last presentation are
+   rehashed. The row CRCs are then combined as in zlib's crc32_combine,
+   so the result is the CRC32 of the whole framebuffer. Rows all have
+   the same length, so the "shift by one row" operator is linear and
+   is tabulated once per byte of the CRC.
+-----------------------------------------------------------*/
+static void init_row_shift(gc9a01_state_t *state) {
+  uint32_t bit_shift[32];
+  for (int i = 0; i < 32; i++) {
+    uint32_t c = 1u << i;
+    for (uint32_t n = 0; n < state->width * 4; n++) {
+      c = crc_table[c & 0xff] ^ (c >> 8);
+    }
+    bit_shift[i] = c;
+  }
+  for (int k = 0; k < 4; k++) {
+    for (uint32_t b = 0; b < 256; b++) {
+      uint32_t c = 0;
+      for (int i = 0; i < 8; i++) {
+        if (b & (1u << i)) {
+          c ^= bit_shift[k * 8 + i];
+        }
+      }
+      state->row_shift[k][b] = c;
+    }
+  }
+}
+
+static inline void update_row_crc(gc9a01_state_t *state, uint32_t y) {
+  state->row_crc[y] = crc32(state->presented + y * state->width, state->width * 4);
+}
+
+static uint32_t frame_crc(gc9a01_state_t *state) {
+  uint32_t c = 0;
+  for (uint32_t y = 0; y < state->height; y++) {
+    c = state->row_shift[0][c & 0xff] ^ state->row_shift[1][(c >> 8) & 0xff] ^
+        state->row_shift[2][(c >> 16) & 0xff] ^ state->row_shift[3][c >> 24] ^ state->row_crc[y];
+  }
+  return c;
+}
+
+/*-----------------------------------------------------------
+   Queue pixels [offset, offset + count) for presentation. Runs that
+   are contiguous in the framebuffer are merged into one buffer_write.
+-----------------------------------------------------------*/
+static void queue_present(gc9a01_state_t *state, const uint32_t *source, uint32_t *queued_offset,
+                          uint32_t *queued, uint32_t offset, uint32_t count) {
+  if (*queued > 0 && *queued_offset + *queued != offset) {
+    write_framebuffer(state, source, *queued_offset, *queued);
+    *queued = 0;
+  }
+  if (*queued == 0) {
+    *queued_offset = offset;
+  }
+  *queued += count;
+  memcpy(state->presented + offset, source + offset, count * 4);
+}
+
+/*-----------------------------------------------------------
+   Dead writes: every write to a pixel after the first one before it
+   was presented was never seen. Each row is counted (and its counts
+   cleared, unless the heatmap still needs them) when a presentation
+   sends it, so writes that land on a row while a sliced presentation
+   is under way are counted with the presentation that shows them.
+   Only the dirty span can have been written. The totals are reported
+   once the presentation finishes.
+-----------------------------------------------------------*/
+static void count_dead_writes(gc9a01_state_t *state, uint32_t y) {
+  uint32_t region_width  = (state->width  + GC9A01_DEAD_GRID - 1) / GC9A01_DEAD_GRID;
+  uint32_t region_height = (state->height + GC9A01_DEAD_GRID - 1) / GC9A01_DEAD_GRID;
+  uint8_t *counts = state->write_counts + y * state->width;
+  uint64_t *row_regions = state->dead_pending_regions + (y / region_height) * GC9A01_DEAD_GRID;
+  for (uint32_t x = state->dirty_left[y]; x <= state->dirty_right[y]; x++) {
+    uint32_t n = counts[x];
+    if (n > 1) {
+      state->dead_pending += n - 1;
+      row_regions[x / region_width] += n - 1;
+    }
+    state->dead_pending_written += n;
+  }
+  if (!state->heatmap_enabled) {
+    memset(counts + state->dirty_left[y], 0, state->dirty_right[y] - state->dirty_left[y] + 1);
+  }
+}
+
+static void report_dead_writes(gc9a01_state_t *state) {
+  uint64_t written = state->dead_pending_written;
+  uint64_t dead = state->dead_pending;
+  state->stats.counted_writes += written;
+  state->stats.dead_writes += dead;
+  state->dead_pending_written = 0;
+  state->dead_pending = 0;
+  if (dead == 0) {
+    return;
+  }
+
+  uint64_t *regions = state->dead_pending_regions;
+  uint32_t worst = 0;
+  for (uint32_t i = 0; i < GC9A01_DEAD_GRID * GC9A01_DEAD_GRID; i++) {
+    state->stats.dead_regions[i] += regions[i];
+    if (regions[i] > regions[worst]) {
+      worst = i;
+    }
+  }
+  uint32_t region_width  = (state->width  + GC9A01_DEAD_GRID - 1) / GC9A01_DEAD_GRID;
+  uint32_t region_height = (state->height + GC9A01_DEAD_GRID - 1) / GC9A01_DEAD_GRID;
+  uint32_t x0 = (worst % GC9A01_DEAD_GRID) * region_width;
+  uint32_t y0 = (worst / GC9A01_DEAD_GRID) * region_height;
+  printf("GC9A01 refresh @%.6fs: %llu of %llu px writes dead (%.1f%%), most in (%u,%u)-(%u,%u): %llu\n",
+         get_sim_nanos() / 1e9, (unsigned long long)dead, (unsigned long long)written,
+         100.0 * dead / written, x0, y0, x0 + region_width - 1, y0 + region_height - 1,
+         (unsigned long long)regions[worst]);
+  memset(regions, 0, sizeof(state->dead_pending_regions));
+}
+
+/*-----------------------------------------------------------
+   Presentation of the dirty part of source (normally the shadow
+   framebuffer) to the simulator. Each dirty row span is compared
+   against the last presented frame and only the runs that actually
+   changed are sent; runs separated by fewer than GC9A01_PRESENT_GAP
+   unchanged pixels are sent as one.
+
+   Like the panel's own scan-out, a presentation walks the rows top to
+   bottom and may span several callbacks (present_rows stops once its
+   budget is spent): writes landing below present_row are picked up
+   by this presentation, writes above it by the next.
+-----------------------------------------------------------*/
+static void begin_present(gc9a01_state_t *state, const uint32_t *source) {
+  state->presenting = true;
+  state->present_source = source;
+  state->present_row = state->dirty_top;
+  state->present_writes = state->stats.buffer_writes;
+}
+
+static void finish_present(gc9a01_state_t *state) {
+  state->presenting = false;
+
+  // Rows written above present_row during the presentation stay dirty.
+  state->dirty_top = 0xffff;
+  state->dirty_bottom = 0;
+  for (uint32_t y = 0; y < state->height; y++) {
+    if (state->dirty_left[y] <= state->dirty_right[y]) {
+      if (y < state->dirty_top)    state->dirty_top = y;
+      if (y > state->dirty_bottom) state->dirty_bottom = y;
+    }
+  }
+
+  if (state->dead_writes_enabled) {
+    report_dead_writes(state);
+  }
+
+  bool changed = state->stats.buffer_writes != state->present_writes;
+  if (changed) {
+    state->stats.frames++;
+  }
+  if (state->crc_enabled && (changed || state->crc_pending)) {
+    printf("GC9A01 frame %u @%.6fs: crc %08x\n",
+           state->stats.frames, get_sim_nanos() / 1e9, frame_crc(state));
+    state->crc_pending = false;
+  }
+}
+
+// Present rows within budget pixels; returns the pixels spent.
+static uint32_t present_rows(gc9a01_state_t *state, uint32_t budget) {
+  const uint32_t *source = state->present_source;
+  uint32_t queued = 0;
+  uint32_t queued_offset = 0;
+  uint32_t spent = 0;
+
+  uint32_t y = state->present_row;
+  for (; y <= state->dirty_bottom && y < state->height && spent < budget; y++) {
+    if (state->dirty_left[y] > state->dirty_right[y]) {
+      continue;
+    }
+    if (row_stale(state, y)) {
+      spent += materialize_row(state, y);
+    }
+    const uint32_t *shadow = source + y * state->width;
+    const uint32_t *presented = state->presented + y * state->width;
+    uint32_t end = state->dirty_right[y] + 1;
+    spent += end - state->dirty_left[y];
+
+    uint32_t x = find_change(shadow, presented, state->dirty_left[y], end);
+    bool changed = x < end;
+    while (x < end) {
+      uint32_t run_start = x;
+      uint32_t run_end = x + 1;
+      for (;;) {
+        while (run_end < end && shadow[run_end] != presented[run_end]) {
+          run_end++;
+        }
+        x = find_change(shadow, presented, run_end, end);
+        if (x >= end || x - run_end >= GC9A01_PRESENT_GAP) {
+          break;
+        }
+        run_end = x + 1;
+      }
+      queue_present(state, source, &queued_offset, &queued, y * state->width + run_start, run_end - run_start);
+    }
+    if (changed && state->crc_enabled) {
+      update_row_crc(state, y);
+    }
+    if (state->dead_writes_enabled && !state->heatmap_enabled) {
+      count_dead_writes(state, y);
+    }
+
+    state->dirty_left[y] = 0xffff;
+    state->dirty_right[y] = 0;
+  }
+  state->present_row = y;
+
+  if (queued > 0) {
+    write_framebuffer(state, source, queued_offset, queued);
+  }
+  if (y > state->dirty_bottom || y >= state->height) {
+    finish_present(state);
+  }
+  return spent;
+}
+
+/*-----------------------------------------------------------
+   Background work: one slice budget of the presentation in
+   progress. What is left continues on the slice timer.
+-----------------------------------------------------------*/
+static void run_background(gc9a01_state_t *state) {
+  if (state->presenting) {
+    present_rows(state, state->slice_pixels);
+  }
+  if (state->presenting && !state->slice_armed) {
+    timer_start_ns(state->slice_timer, GC9A01_SLICE_NS, false);
+    state->slice_armed = true;
+  }
+}
+
+static void gc9a01_slice(void *user_data) {
+  gc9a01_state_t *state = (gc9a01_state_t *)user_data;
+  state->slice_armed = false;
+  run_background(state);
+}
+
+/*-----------------------------------------------------------
+   Reset the panel to black: a new generation makes every row stale
+   (see row_stale) and dirty; no pixel is touched yet.
+-----------------------------------------------------------*/
+static void clear_panel(gc9a01_state_t *state) {
+  state->clear_generation++;
+  state->stale_rows = state->height;
+  for (uint32_t y = 0; y < state->height; y++) {
+    state->cover_left[y] = 0xffff;
+    state->cover_right[y] = 0;
+    mark_dirty(state, y, 0, state->width - 1);
+  }
+}
+
+/*-----------------------------------------------------------
+   Per-opcode timing: a command's data phase starts with its command
+   byte and ends when its last parameter arrives. For RAMWR it ends
+   when the window is filled, at the next command or when CS rises;
+   so does it for unmodelled commands, whose parameter count is not
+   known.
+-----------------------------------------------------------*/
+static void end_opcode_timing(gc9a01_state_t *state) {
+  if (!state->opcode_timing) {
+    return;
+  }
+  gc9a01_opcode_stats_t *opcode = &state->opcodes[state->current_command];
+  uint64_t latency = get_sim_nanos() - state->opcode_start_ns;
+  opcode->count++;
+  opcode->latency_ns += latency;
+  if (latency > opcode->max_latency_ns) {
+    opcode->max_latency_ns = latency;
+  }
+  state->opcode_timing = false;
+}
+
+// Ends the previous command's data phase; current_command is then
+// switched to the new command by the caller.
+static void begin_opcode_timing(gc9a01_state_t *state) {
+  end_opcode_timing(state);
+  state->opcode_timing = true;
+  state->opcode_start_ns = get_sim_nanos();
+}
+
+/*-----------------------------------------------------------
+   Print the per-opcode command table (totals since start).
+-----------------------------------------------------------*/
+static void dump_opcode_table(gc9a01_state_t *state) {
+  printf("GC9A01 command table @%.3fs\n", get_sim_nanos() / 1e9);
+  printf("GC9A01   op     count        bytes   avg us   max us\n");
+  for (uint32_t op = 0; op < 256; op++) {
+    const gc9a01_opcode_stats_t *opcode = &state->opcodes[op];
+    if (opcode->count == 0) {
+      continue;
+    }
+    printf("GC9A01   %02X %9u %12llu %8.1f %8.1f\n", op, opcode->count,
+           (unsigned long long)opcode->bytes, opcode->latency_ns / 1e3 / opcode->count,
+           opcode->max_latency_ns / 1e3);
+  }
+}
+
+static void gc9a01_report_opcodes(void *user_data) {
+  dump_opcode_table((gc9a01_state_t *)user_data);
+}
+
+/*-----------------------------------------------------------
+   Count writes to pixels [offset, offset + count) for the overdraw
+   heatmap and the dead-write detector (saturating at 255).
+-----------------------------------------------------------*/
+static inline void count_writes(gc9a01_state_t *state, uint32_t offset, uint32_t count, uint32_t times) {
+  uint8_t *counts = state->write_counts + offset;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t n = counts[i] + times;
+    counts[i] = n > 255 ? 255 : n;
+  }
+}
+
+/*-----------------------------------------------------------
+   Render the write counts of the last refresh interval as a heatmap:
+   black = not written, then blue, green, yellow, orange and red for
+   pixels written 1, 2, 3, 4 and 5+ times.
+-----------------------------------------------------------*/
+static void render_heatmap(gc9a01_state_t *state) {
+  static const uint32_t colors[6] = {
+    0xff000000, 0xffc04000, 0xff00c000, 0xff00e0e0, 0xff0080ff, 0xff0000ff,
+  };
+  for (uint32_t i = 0; i < state->width * state->height; i++) {
+    uint8_t n = state->write_counts[i];
+    state->heatmap[i] = colors[n < 5 ? n : 5];
+  }
+  memset(state->write_counts, 0, state->width * state->height);
+}
+
+/*-----------------------------------------------------------
+   Enable or disable the overdraw heatmap. The whole panel is marked
+   dirty so the next refresh repaints it from the new source.
+-----------------------------------------------------------*/
+static void set_heatmap(gc9a01_state_t *state, bool enabled) {
+  if (enabled && !state->heatmap) {
+    if (!state->write_counts) {
+      state->write_counts = calloc(state->width * state->height, sizeof(uint8_t));
+    }
+    state->heatmap = calloc(state->width * state->height, sizeof(uint32_t));
+    if (!state->write_counts || !state->heatmap) {
+      printf("GC9A01: Failed to allocate heatmap memory!\n");
+      free(state->heatmap);
+      state->heatmap = NULL;
+      return;
+    }
+  }
+  if (enabled) {
+    memset(state->write_counts, 0, state->width * state->height);
+  }
+  state->heatmap_enabled = enabled;
+  state->counting_writes = state->heatmap_enabled || state->dead_writes_enabled;
+  for (uint32_t y = 0; y < state->height; y++) {
+    mark_dirty(state, y, 0, state->width - 1);
+  }
+}
+
+/*-----------------------------------------------------------
+   Event trace: send the filled buffer over the TRACE UART (if the
+   previous one has gone out) and switch to the other buffer.
+-----------------------------------------------------------*/
+static void trace_flush(gc9a01_state_t *state) {
+  if (!state->trace_enabled || state->trace_busy || state->trace_fill == 0) {
+    return;
+  }
+  if (uart_write(state->trace_uart, state->trace_buffer[state->trace_active], state->trace_fill)) {
+    state->trace_busy = true;
+    state->trace_active ^= 1;
+    state->trace_fill = 0;
+  }
+}
+
+static void gc9a01_trace_write_done(void *user_data) {
+  gc9a01_state_t *state = (gc9a01_state_t *)user_data;
+  state->trace_busy = false;
+  // Keep the UART busy while there is a good amount queued; smaller
+  // leftovers go out on the next refresh.
+  if (state->trace_fill >= GC9A01_TRACE_BUFFER_SIZE / 2) {
+    trace_flush(state);
+  }
+}
+
+/*-----------------------------------------------------------
+   Event trace: append one record (tag, time delta and, for SPI
+   chunks, the payload). Records that do not fit while the UART is
+   still busy are dropped and reported by an overflow record.
+-----------------------------------------------------------*/
+static void trace_record(gc9a01_state_t *state, uint8_t tag, const uint8_t *data, uint32_t len) {
+  uint32_t size = 1 + 2 * GC9A01_TRACE_VARINT_MAX + len;
+  if (state->trace_dropped > 0) {
+    size += 1 + 2 * GC9A01_TRACE_VARINT_MAX;
+  }
+  if (state->trace_fill + size > GC9A01_TRACE_BUFFER_SIZE) {
+    trace_flush(state);
+    if (state->trace_fill + size > GC9A01_TRACE_BUFFER_SIZE) {
+      if (state->trace_dropped++ == 0) {
+        uint64_t now = get_sim_nanos();
+        if (state->trace_warned_ns == 0 || now - state->trace_warned_ns >= GC9A01_WARNING_INTERVAL_NS) {
+          printf("GC9A01 warning @%.6fs: the TRACE UART cannot keep up, dropping records "
+                 "(raise trace_baud)\n", now / 1e9);
+          state->trace_warned_ns = now;
+        }
+      }
+      return;
+    }
+  }
+
+  uint64_t now = get_sim_nanos();
+  uint8_t *out = state->trace_buffer[state->trace_active] + state->trace_fill;
+  uint32_t n = 0;
+  if (state->trace_dropped > 0) {
+    out[n++] = GC9A01_TRACE_OVERFLOW;
+    n += gc9a01_trace_put_varint(out + n, now - state->trace_last_ns);
+    n += gc9a01_trace_put_varint(out + n, state->trace_dropped);
+    state->trace_last_ns = now;
+    state->trace_dropped = 0;
+  }
+  out[n++] = tag;
+  n += gc9a01_trace_put_varint(out + n, now - state->trace_last_ns);
+  if (tag == GC9A01_TRACE_SPI) {
+    n += gc9a01_trace_put_varint(out + n, len);
+    memcpy(out + n, data, len);
+    n += len;
+  }
+  state->trace_fill += n;
+  state->trace_last_ns = now;
+}
+
+/*-----------------------------------------------------------
+   Event trace: set up the TRACE UART and emit the stream header.
+-----------------------------------------------------------*/
+static void init_trace(gc9a01_state_t *state) {
+  state->trace_buffer[0] = malloc(GC9A01_TRACE_BUFFER_SIZE);
+  state->trace_buffer[1] = malloc(GC9A01_TRACE_BUFFER_SIZE);
+  if (!state->trace_buffer[0] || !state->trace_buffer[1]) {
+    printf("GC9A01: Failed to allocate trace memory!\n");
+    return;
+  }
+
+  uint32_t baud_rate = attr_read(attr_init("trace_baud", GC9A01_DEFAULT_TRACE_BAUD));
+  const uart_config_t uart_config = {
+    .tx = pin_init("TRACE", OUTPUT_HIGH),
+    .rx = NO_PIN,
+    .baud_rate = baud_rate ? baud_rate : GC9A01_DEFAULT_TRACE_BAUD,
+    .write_done = gc9a01_trace_write_done,
+    .user_data = state,
+  };
+  state->trace_uart = uart_init(&uart_config);
+  state->trace_enabled = true;
+
+  memcpy(state->trace_buffer[0], GC9A01_TRACE_MAGIC, GC9A01_TRACE_HEADER_SIZE - 1);
+  state->trace_buffer[0][GC9A01_TRACE_HEADER_SIZE - 1] = GC9A01_TRACE_VERSION;
+  state->trace_fill = GC9A01_TRACE_HEADER_SIZE;
+  state->trace_last_ns = get_sim_nanos();
+}
+
+/*-----------------------------------------------------------
+   Refresh timer callback: the panel scans out the shadow RAM
+   (or the overdraw heatmap).
+-----------------------------------------------------------*/
+static void gc9a01_refresh(void *user_data) {
+  gc9a01_state_t *state = (gc9a01_state_t *)user_data;
+
+  trace_flush(state);
+
+  uint32_t dump_opcodes = attr_read(state->dump_opcodes_attr);
+  if (dump_opcodes != state->dump_opcodes_value) {
+    state->dump_opcodes_value = dump_opcodes;
+    dump_opcode_table(state);
+  }
+
+  bool heatmap = attr_read(state->heatmap_attr) != 0;
+  if (heatmap != state->heatmap_enabled) {
+    set_heatmap(state, heatmap);
+  }
+
+  // A presentation still in progress just gets another slice.
+  if (!state->presenting) {
+    if (state->heatmap_enabled) {
+      // The heatmap shows (and then drops) the counts of the whole
+      // refresh interval, so dead writes are counted here instead.
+      for (uint32_t y = state->dirty_top; state->dead_writes_enabled && y <= state->dirty_bottom; y++) {
+        if (state->dirty_left[y] <= state->dirty_right[y]) {
+          count_dead_writes(state, y);
+        }
+      }
+      render_heatmap(state);
+      for (uint32_t y = 0; y < state->height; y++) {
+        mark_dirty(state, y, 0, state->width - 1);
+      }
+      begin_present(state, state->heatmap);
+    } else {
+      begin_present(state, state->shadow);
+    }
+  }
+  run_background(state);
+}
+
+/*-----------------------------------------------------------
+   Close the current RAMWR window: if it wasted pixels, merge it into
+   the worst-windows table (same window coordinates add up; otherwise
+   it replaces the least wasteful entry).
+-----------------------------------------------------------*/
+static void close_window_stats(gc9a01_state_t *state) {
+  gc9a01_window_stats_t *window = &state->window_stats;
+  if (window->masked > 0) {
+    gc9a01_window_stats_t *slot = &state->worst_windows[0];
+    for (uint32_t i = 0; i < GC9A01_WORST_WINDOWS; i++) {
+      gc9a01_window_stats_t *entry = &state->worst_windows[i];
+      if (entry->masked > 0 &&
+          entry->col_start == window->col_start && entry->col_end == window->col_end &&
+          entry->row_start == window->row_start && entry->row_end == window->row_end) {
+        entry->pixels += window->pixels;
+        entry->masked += window->masked;
+        slot = NULL;
+        break;
+      }
+      if (entry->masked < slot->masked) {
+        slot = entry;
+      }
+    }
+    if (slot && slot->masked < window->masked) {
+      *slot = *window;
+    }
+  }
+  window->pixels = 0;
+  window->masked = 0;
+}
+
+/*-----------------------------------------------------------
+   Bus timeline histograms.
+-----------------------------------------------------------*/
+static void add_to_histogram(uint32_t *histogram, uint64_t value) {
+  uint32_t bucket = 0;
+  while (value > 0 && bucket < GC9A01_HISTOGRAM_BUCKETS - 1) {
+    value >>= 1;
+    bucket++;
+  }
+  histogram[bucket]++;
+}
+
+static void print_histogram(const char *label, const uint32_t *now, const uint32_t *last) {
+  printf("GC9A01   %s:", label);
+  for (uint32_t i = 0; i < GC9A01_HISTOGRAM_BUCKETS; i++) {
+    uint32_t n = now[i] - last[i];
+    if (n == 0) {
+      continue;
+    }
+    if (i == 0) {
+      printf(" 0:%u", n);
+    } else if (i == GC9A01_HISTOGRAM_BUCKETS - 1) {
+      printf(" %u+:%u", 1u << (i - 1), n);
+    } else {
+      printf(" %u-%u:%u", 1u << (i - 1), (1u << i) - 1, n);
+    }
+  }
+  printf("\n");
+}
+
+/*-----------------------------------------------------------
+   CS edges: time each transaction and the gap before it. Only the
+   stats report reads these, so without it the edges cost no
+   get_sim_nanos() call.
+-----------------------------------------------------------*/
+static void track_cs_edge(gc9a01_state_t *state, uint32_t value) {
+  uint64_t now = get_sim_nanos();
+
+  if (value == LOW && !state->cs_low) {
+    if (state->cs_seen_high) {
+      uint64_t gap = now - state->cs_rise_ns;
+      add_to_histogram(state->stats.cs_gap_us, gap / 1000);
+      if (gap > state->longest_gap_ns) {
+        state->longest_gap_ns = gap;
+        state->longest_gap_at_ns = state->cs_rise_ns;
+      }
+    }
+    state->cs_low = true;
+    state->cs_fall_ns = now;
+    state->cs_fall_bytes = state->stats.bytes_received;
+  } else if (value == HIGH && state->cs_low) {
+    uint64_t duration = now - state->cs_fall_ns;
+    state->stats.transactions++;
+    state->stats.cs_low_ns += duration;
+    add_to_histogram(state->stats.cs_low_us, duration / 1000);
+    add_to_histogram(state->stats.transaction_bytes, state->stats.bytes_received - state->cs_fall_bytes);
+    state->cs_low = false;
+    state->cs_seen_high = true;
+    state->cs_rise_ns = now;
+  } else if (value == HIGH) {
+    state->cs_seen_high = true;
+    state->cs_rise_ns = now;
+  }
+}
+
+/*-----------------------------------------------------------
+   Window overhead: classify a RAMWR window by area and charge it
+   with the window setup bytes sent since the previous RAMWR.
+-----------------------------------------------------------*/
+static const char *const area_bucket_names[GC9A01_AREA_BUCKETS] = {
+  "invalid", "1", "2-15", "16-255", "256-4095", "4096+",
+};
+
+static void count_window_overhead(gc9a01_state_t *state) {
+  uint64_t area = state->window_area;
+  uint32_t bucket = area == 0 ? 0 : area == 1 ? 1 : area < 16 ? 2 : area < 256 ? 3 : area < 4096 ? 4 : 5;
+
+  uint64_t setup = state->opcodes[GC9A01_CASET].bytes + state->opcodes[GC9A01_RASET].bytes +
+                   state->stats.commands[GC9A01_RAMWR];
+  state->window_bucket = bucket;
+  state->stats.windows[bucket]++;
+  state->stats.window_overhead_bytes[bucket] += setup - state->window_setup_mark;
+  state->window_setup_mark = setup;
+}
+
+/*-----------------------------------------------------------
+   Protocol violations: count one and warn about it, unless the same
+   kind was already warned about within GC9A01_WARNING_INTERVAL_NS.
+-----------------------------------------------------------*/
+static const char *const violation_names[GC9A01_VIOLATIONS] = {
+  "stray data", "odd byte", "window overrun", "no window",
+};
+
+static const char *const violation_warnings[GC9A01_VIOLATIONS] = {
+  "data bytes with no command or RAMWR to receive them",
+  "CS rose with half a pixel pending",
+  "RAMWR wrote past the end of its window and wrapped around",
+  "RAMWR before any CASET/RASET",
+};
+
+static void count_violation(gc9a01_state_t *state, gc9a01_violation_t kind, uint64_t bytes) {
+  state->stats.violations[kind]++;
+  state->stats.violation_bytes[kind] += bytes;
+
+  uint64_t now = get_sim_nanos();
+  if (state->violation_warned_ns[kind] != 0 &&
+      now - state->violation_warned_ns[kind] < GC9A01_WARNING_INTERVAL_NS) {
+    state->violation_suppressed[kind]++;
+    return;
+  }
+  printf("GC9A01 warning @%.6fs: %s (%llu bytes)", now / 1e9, violation_warnings[kind],
+         (unsigned long long)bytes);
+  if (state->violation_suppressed[kind] > 0) {
+    printf(", %u more since the last warning", state->violation_suppressed[kind]);
+  }
+  printf("\n");
+  state->violation_warned_ns[kind] = now ? now : 1;
+  state->violation_suppressed[kind] = 0;
+}
+
+/*-----------------------------------------------------------
+   Stats timer callback: print the counters accumulated since the
+   last report, with rates based on simulated time.
+-----------------------------------------------------------*/
+static void gc9a01_report_stats(void *user_data) {
+  gc9a01_state_t *state = (gc9a01_state_t *)user_data;
+  const gc9a01_stats_t *now = &state->stats;
+  const gc9a01_stats_t *last = &state->stats_reported;
+
+  uint64_t now_ns = get_sim_nanos();
+  double seconds = (now_ns - state->stats_reported_ns) / 1e9;
+  if (seconds <= 0) {
+    return;
+  }
+
+  uint64_t pixels = now->pixels_written - last->pixels_written;
+  uint32_t frames = now->frames - last->frames;
+  printf("GC9A01 @%.3fs: %llu bytes, %llu px (%.0f px/s), %u frames (%.1f fps), "
+         "%u buffer_write, %u spi_done, %u redundant cmds (%u bytes)\n",
+         now_ns / 1e9,
+         (unsigned long long)(now->bytes_received - last->bytes_received),
+         (unsigned long long)pixels, pixels / seconds,
+         frames, frames / seconds,
+         now->buffer_writes - last->buffer_writes,
+         now->spi_done_calls - last->spi_done_calls,
+         now->redundant_commands - last->redundant_commands,
+         now->redundant_bytes - last->redundant_bytes);
+
+  printf("GC9A01   commands:");
+  for (uint32_t op = 0; op < 256; op++) {
+    if (now->commands[op] != last->commands[op]) {
+      printf(" %02X=%u", op, now->commands[op] - last->commands[op]);
+    }
+  }
+  printf("\n");
+
+  uint64_t masked = now->masked_pixels - last->masked_pixels;
+  uint64_t bytes = now->bytes_received - last->bytes_received;
+  printf("GC9A01   masked: %llu px (%llu bytes, %.1f%% of bus, %.0f px/frame)\n",
+         (unsigned long long)masked, (unsigned long long)(masked * 2),
+         bytes ? 100.0 * masked * 2 / bytes : 0.0,
+         frames ? (double)masked / frames : 0.0);
+
+  close_window_stats(state);
+  for (uint32_t n = 0; n < GC9A01_WORST_WINDOWS; n++) {
+    gc9a01_window_stats_t *worst = NULL;
+    for (uint32_t i = 0; i < GC9A01_WORST_WINDOWS; i++) {
+      gc9a01_window_stats_t *entry = &state->worst_windows[i];
+      if (entry->masked > 0 && (!worst || entry->masked > worst->masked)) {
+        worst = entry;
+      }
+    }
+    if (!worst) {
+      break;
+    }
+    printf("GC9A01     window (%u,%u)-(%u,%u): %u of %u px masked (%.0f%%)\n",
+           worst->col_start, worst->row_start, worst->col_end, worst->row_end,
+           worst->masked, worst->pixels, 100.0 * worst->masked / worst->pixels);
+    worst->masked = 0;
+  }
+  memset(state->worst_windows, 0, sizeof(state->worst_windows));
+
+  // Count the open transaction up to now so long transfers show up.
+  uint64_t cs_low_ns = now->cs_low_ns - last->cs_low_ns;
+  uint64_t interval_ns = now_ns - state->stats_reported_ns;
+  if (state->cs_low) {
+    uint64_t since = state->cs_fall_ns > state->stats_reported_ns ? state->cs_fall_ns : state->stats_reported_ns;
+    cs_low_ns += now_ns - since;
+  }
+  printf("GC9A01   bus: %u transactions, CS low %.1f%% of the time",
+         now->transactions - last->transactions, 100.0 * cs_low_ns / interval_ns);
+  if (state->longest_gap_ns > 0) {
+    printf(", longest gap %.1f us at %.6fs", state->longest_gap_ns / 1e3, state->longest_gap_at_ns / 1e9);
+  }
+  printf("\n");
+  print_histogram("CS low (us)", now->cs_low_us, last->cs_low_us);
+  print_histogram("CS gap (us)", now->cs_gap_us, last->cs_gap_us);
+  print_histogram("bytes/transaction", now->transaction_bytes, last->transaction_bytes);
+
+  uint64_t overhead = 0;
+  uint64_t payload = 0;
+  for (uint32_t i = 0; i < GC9A01_AREA_BUCKETS; i++) {
+    overhead += now->window_overhead_bytes[i] - last->window_overhead_bytes[i];
+    payload += now->window_payload_bytes[i] - last->window_payload_bytes[i];
+  }
+  if (overhead + payload > 0) {
+    printf("GC9A01   window overhead: %llu setup bytes for %llu pixel bytes (%.1f%% overhead)\n",
+           (unsigned long long)overhead, (unsigned long long)payload,
+           100.0 * overhead / (overhead + payload));
+    for (uint32_t i = 0; i < GC9A01_AREA_BUCKETS; i++) {
+      uint32_t windows = now->windows[i] - last->windows[i];
+      uint64_t bucket_overhead = now->window_overhead_bytes[i] - last->window_overhead_bytes[i];
+      uint64_t bucket_payload = now->window_payload_bytes[i] - last->window_payload_bytes[i];
+      if (windows == 0) {
+        continue;
+      }
+      printf("GC9A01     area %-8s %u windows, %.1f setup + %.1f pixel bytes/window (%.1f%% overhead)\n",
+             area_bucket_names[i], windows,
+             (double)bucket_overhead / windows, (double)bucket_payload / windows,
+             bucket_overhead + bucket_payload ? 100.0 * bucket_overhead / (bucket_overhead + bucket_payload) : 0.0);
+    }
+  }
+  bool violations = false;
+  for (uint32_t i = 0; i < GC9A01_VIOLATIONS; i++) {
+    uint32_t n = now->violations[i] - last->violations[i];
+    if (n == 0) {
+      continue;
+    }
+    printf("%s %s %u (%llu bytes)", violations ? "," : "GC9A01   violations:", violation_names[i], n,
+           (unsigned long long)(now->violation_bytes[i] - last->violation_bytes[i]));
+    violations = true;
+  }
+  if (violations) {
+    printf("\n");
+  }
+
+  uint64_t dead = now->dead_writes - last->dead_writes;
+  if (state->dead_writes_enabled && dead > 0) {
+    uint64_t written = now->counted_writes - last->counted_writes;
+    printf("GC9A01   dead writes: %llu of %llu px writes (%.1f%%, %llu bytes), by region:\n",
+           (unsigned long long)dead, (unsigned long long)written,
+           100.0 * dead / written, (unsigned long long)(dead * 2));
+    for (uint32_t y = 0; y < GC9A01_DEAD_GRID; y++) {
+      printf("GC9A01    ");
+      for (uint32_t x = 0; x < GC9A01_DEAD_GRID; x++) {
+        uint32_t i = y * GC9A01_DEAD_GRID + x;
+        printf(" %10llu", (unsigned long long)(now->dead_regions[i] - last->dead_regions[i]));
+      }
+      printf("\n");
+    }
+  }
+
+  if (state->crc_enabled) {
+    printf("GC9A01   frame crc: %08x (frame %u)\n", frame_crc(state), now->frames);
+  }
+  state->longest_gap_ns = 0;
+  state->longest_gap_at_ns = 0;
+
+  state->stats_reported = state->stats;
+  state->stats_reported_ns = now_ns;
+}
+
+/*-----------------------------------------------------------
+   Count a command that leaves the registers unchanged.
+-----------------------------------------------------------*/
+static void skip_redundant(gc9a01_state_t *state, uint8_t len) {
+  state->stats.redundant_commands++;
+  state->stats.redundant_bytes += 1 + len;
+}
+
 /*-----------------------------------------------------------
    Process a complete command (command byte and parameters).
 -----------------------------------------------------------*/
@@ -125,16 +1372,13 @@ static void process_command(gc9a01_state_t *state, uint8_t command, uint8_t *arg
   switch (command) {
     case GC9A01_SWRESET:
       {
-        // Fill framebuffer with black.
-        uint32_t black = 0xff000000;
-        for (uint32_t y = 0; y < state->height; y++) {
-          for (uint32_t x = 0; x < state->width; x++) {
-            uint32_t offset = (y * state->width + x) * 4;
-            buffer_write(state->framebuffer, offset, &black, sizeof(black));
-          }
-        }
+        // Blank the panel lazily: every row goes stale and is filled
+        // with black only when it is next written or presented.
+        clear_panel(state);
         state->display_on = false;
         state->inverted = false;
+        state->madctl = 0;
+        state->colmod = 0;
         state->ram_write = false;
         state->col_start = 0;
         state->col_end = state->width - 1;
@@ -142,42 +1386,92 @@ static void process_command(gc9a01_state_t *state, uint8_t command, uint8_t *arg
         state->row_end = state->height - 1;
         state->current_col = 0;
         state->current_row = 0;
+        state->window_set = 0;
+        clip_window(state);
       }
       break;
     case GC9A01_SLPOUT:
       break;
     case GC9A01_DISPON:
       state->display_on = true;
+      state->crc_pending = true;
       break;
     case GC9A01_DISPOFF:
       state->display_on = false;
       break;
     case GC9A01_CASET:
       if (len == 4) {
-        state->col_start = (args[0] << 8) | args[1];
-        state->col_end   = (args[2] << 8) | args[3];
+        uint16_t start = (args[0] << 8) | args[1];
+        uint16_t end   = (args[2] << 8) | args[3];
+        if (start == state->col_start && end == state->col_end) {
+          skip_redundant(state, len);
+        } else {
+          state->col_start = start;
+          state->col_end   = end;
+          clip_window(state);
+        }
         state->current_col = state->col_start;
+        state->window_set |= 1;
       }
       break;
     case GC9A01_RASET:
       if (len == 4) {
-        state->row_start = (args[0] << 8) | args[1];
-        state->row_end   = (args[2] << 8) | args[3];
+        uint16_t start = (args[0] << 8) | args[1];
+        uint16_t end   = (args[2] << 8) | args[3];
+        if (start == state->row_start && end == state->row_end) {
+          skip_redundant(state, len);
+        } else {
+          state->row_start = start;
+          state->row_end   = end;
+          clip_window(state);
+        }
         state->current_row = state->row_start;
+        state->window_set |= 2;
       }
       break;
     case GC9A01_RAMWR:
+      if (state->window_set != 3) {
+        count_violation(state, GC9A01_VIOLATION_NO_WINDOW, 1);
+      }
+      count_window_overhead(state);
+      close_window_stats(state);
+      state->window_stats.col_start = state->col_start;
+      state->window_stats.col_end   = state->col_end;
+      state->window_stats.row_start = state->row_start;
+      state->window_stats.row_end   = state->row_end;
       state->ram_write = true;
+      state->window_written = 0;
       state->pending_data_valid = false;
+      state->point_write = state->window_visible &&
+                           state->col_start == state->col_end &&
+                           state->row_start == state->row_end;
       break;
     case GC9A01_MADCTL:
+      if (len == 1) {
+        if (args[0] == state->madctl) {
+          skip_redundant(state, len);
+        }
+        state->madctl = args[0];
+      }
       break;
     case GC9A01_COLMOD:
+      if (len == 1) {
+        if (args[0] == state->colmod) {
+          skip_redundant(state, len);
+        }
+        state->colmod = args[0];
+      }
       break;
     case GC9A01_INVOFF:
+      if (!state->inverted) {
+        skip_redundant(state, len);
+      }
       state->inverted = false;
       break;
     case GC9A01_INVON:
+      if (state->inverted) {
+        skip_redundant(state, len);
+      }
       state->inverted = true;
       break;
     default:
@@ -186,44 +1480,216 @@ static void process_command(gc9a01_state_t *state, uint8_t command, uint8_t *arg
 }
 
 /*-----------------------------------------------------------
-   Process one pixel (16-bit RGB565 value) received during RAMWR.
-   Pixels are written into the defined address window and then
-   converted to 32-bit RGBA. A rounded‐mask is applied so that
-   pixels outside a centered circle (radius = width/2) are forced black.
+   Compute the rounded mask: for each row, the span of columns
+   that lies inside the centered circle (radius = width/2).
+-----------------------------------------------------------*/
+static bool init_mask(gc9a01_state_t *state) {
+  state->mask_left  = calloc(state->height, sizeof(uint16_t));
+  state->mask_right = calloc(state->height, sizeof(uint16_t));
+  if (!state->mask_left || !state->mask_right) {
+    return false;
+  }
+
+  const int center = state->width / 2;
+  for (uint32_t y = 0; y < state->height; y++) {
+    int dy = (int)y - center;
+    int remaining = center * center - dy * dy;
+    if (remaining < 0) {
+      state->mask_left[y]  = 1;
+      state->mask_right[y] = 0;
+      continue;
+    }
+    int half = center;
+    while (half * half > remaining) {
+      half--;
+    }
+    int left  = center - half;
+    int right = center + half;
+    if (right > (int)state->width - 1) {
+      right = state->width - 1;
+    }
+    state->mask_left[y]  = left;
+    state->mask_right[y] = right;
+  }
+  return true;
+}
+
+/*-----------------------------------------------------------
+   Convert a span of big-endian RGB565 pixels on one row to RGBA.
+   The span must lie on the panel (see clip_window). Columns outside
+   the rounded mask are forced black; inversion flips the RGB
+   channels of the visible pixels. Returns the number of pixels
+   inside the mask.
 -----------------------------------------------------------*/
-static void process_pixel(gc9a01_state_t *state, uint16_t pixel_val) {
-  uint32_t color = rgb565_to_rgba(pixel_val);
+static uint32_t convert_span(gc9a01_state_t *state, const uint8_t *data, uint32_t *out,
+                         uint32_t col, uint32_t row, uint32_t count) {
+  const uint32_t black = GC9A01_BLACK;
+  const uint32_t invert = state->inverted ? 0x00ffffff : 0;
 
-  if (state->inverted) {
-    uint8_t r = 255 - ((color >> 16) & 0xFF);
-    uint8_t g = 255 - ((color >> 8)  & 0xFF);
-    uint8_t b = 255 - (color & 0xFF);
-    color = 0xff000000 | (r << 16) | (g << 8) | b;
+  // Visible columns of this span are [left, right); default to none.
+  uint32_t left = col + count;
+  uint32_t right = col + count;
+  if (state->mask_left[row] <= state->mask_right[row]) {
+    left  = col > state->mask_left[row] ? col : state->mask_left[row];
+    right = col + count < (uint32_t)state->mask_right[row] + 1 ? col + count : (uint32_t)state->mask_right[row] + 1;
+    if (left > right) {
+      left = right = col + count;
+    }
   }
 
-  if (state->current_col < state->col_start || state->current_col > state->col_end ||
-      state->current_row < state->row_start || state->current_row > state->row_end) {
-    return;
+  uint32_t i = 0;
+  for (; col + i < left; i++) {
+    out[i] = black;
+  }
+  for (; col + i < right; i++) {
+    uint16_t value = (data[2 * i] << 8) | data[2 * i + 1];
+    out[i] = rgb565_to_rgba(value) ^ invert;
+  }
+  for (; i < count; i++) {
+    out[i] = black;
   }
+  return right - left;
+}
 
-  const int center = state->width / 2;
-  int dx = (int)state->current_col - center;
-  int dy = (int)state->current_row - center;
-  if ((dx * dx + dy * dy) > (center * center)) {
-    color = 0xff000000;
+/*-----------------------------------------------------------
+   Advance the pixel pointer by a number of pixels, wrapping
+   within the address window like the controller does.
+-----------------------------------------------------------*/
+static void advance_pointer(gc9a01_state_t *state, uint32_t pixels) {
+  uint32_t cols = state->col_end - state->col_start + 1;
+  uint32_t rows = state->row_end - state->row_start + 1;
+  uint64_t index = (uint64_t)(state->current_row - state->row_start) * cols +
+                   (state->current_col - state->col_start) + pixels;
+  index %= (uint64_t)cols * rows;
+  state->current_row = state->row_start + index / cols;
+  state->current_col = state->col_start + index % cols;
+}
+
+/*-----------------------------------------------------------
+   Process a burst of pixels received during RAMWR.
+   The burst is split into window row segments. The visible part of
+   each segment (precomputed by clip_window) is converted straight
+   into the shadow framebuffer and marked dirty; the off-panel
+   remainder is skipped. The pixel pointer advances once per segment
+   rather than per pixel. Returns the number of pixels that end up
+   inside the rounded mask.
+-----------------------------------------------------------*/
+static uint32_t process_pixels(gc9a01_state_t *state, const uint8_t *data, uint32_t pixels) {
+  if (!state->window_valid) {
+    return 0;
+  }
+  if (!state->window_visible) {
+    advance_pointer(state, pixels);
+    return 0;
+  }
+
+  uint32_t inside = 0;
+  while (pixels > 0) {
+    uint32_t col = state->current_col;
+    uint32_t row = state->current_row;
+    uint32_t count = state->col_end - col + 1;
+    if (count > pixels) {
+      count = pixels;
+    }
+
+    if (row <= state->vis_row_end && col <= state->vis_col_end) {
+      uint32_t visible = state->vis_col_end - col + 1;
+      if (visible > count) {
+        visible = count;
+      }
+      prepare_write(state, row, col, col + visible - 1);
+      inside += convert_span(state, data, state->shadow + row * state->width + col, col, row, visible);
+      mark_dirty(state, row, col, col + visible - 1);
+      if (state->counting_writes) {
+        count_writes(state, row * state->width + col, visible, 1);
+      }
+    }
+
+    data += count * 2;
+    pixels -= count;
+
+    col += count;
+    if (col > state->col_end) {
+      col = state->col_start;
+      row++;
+      if (row > state->row_end) {
+        row = state->row_start;
+      }
+    }
+    state->current_col = col;
+    state->current_row = row;
+  }
+  return inside;
+}
+
+/*-----------------------------------------------------------
+   Point write: RAMWR into a visible 1x1 window, as sent by
+   Adafruit GFX drawPixel(). The pointer wraps onto the same pixel,
+   so only the last pixel of the burst matters and no window
+   bookkeeping is needed. Returns the number of pixels inside the
+   rounded mask.
+-----------------------------------------------------------*/
+static uint32_t process_point(gc9a01_state_t *state, const uint8_t *data, uint32_t pixels) {
+  uint32_t col = state->col_start;
+  uint32_t row = state->row_start;
+  prepare_write(state, row, col, col);
+  uint32_t inside = convert_span(state, data + (pixels - 1) * 2, state->shadow + row * state->width + col, col, row, 1);
+  mark_dirty(state, row, col, col);
+  if (state->counting_writes) {
+    count_writes(state, row * state->width + col, 1, pixels);
+  }
+  return inside ? pixels : 0;
+}
+
+/*-----------------------------------------------------------
+   Process pixel data received during RAMWR. A pixel whose two bytes
+   straddle two SPI packets is completed from pending_data first.
+   Pixels that land outside the rounded mask are counted as waste.
+-----------------------------------------------------------*/
+static void process_pixel_data(gc9a01_state_t *state, const uint8_t *data, uint32_t count) {
+  uint32_t (*write)(gc9a01_state_t *, const uint8_t *, uint32_t) =
+    state->point_write ? process_point : process_pixels;
+
+  state->stats.window_payload_bytes[state->window_bucket] += count;
+
+  uint32_t total = (count + state->pending_data_valid) / 2;
+  uint32_t inside = 0;
+
+  if (state->pending_data_valid) {
+    uint8_t pixel[2] = { state->pending_data, data[0] };
+    state->pending_data_valid = false;
+    inside += write(state, pixel, 1);
+    data++;
+    count--;
+  }
+
+  uint32_t pixels = count / 2;
+  if (pixels > 0) {
+    inside += write(state, data, pixels);
   }
 
-  uint32_t offset = (state->current_row * state->width + state->current_col) * 4;
-  buffer_write(state->framebuffer, offset, &color, sizeof(color));
+  state->stats.pixels_written += total;
+  state->stats.masked_pixels += total - inside;
+  state->window_stats.pixels += total;
+  state->window_stats.masked += total - inside;
 
-  state->current_col++;
-  if (state->current_col > state->col_end) {
-    state->current_col = state->col_start;
-    state->current_row++;
-    if (state->current_row > state->row_end) {
-      state->current_row = state->row_start;
+  uint64_t written = state->window_written;
+  state->window_written += total;
+  if (state->window_valid && state->window_written > state->window_area) {
+    if (written < state->window_area) {
+      count_violation(state, GC9A01_VIOLATION_OVERRUN, (state->window_written - state->window_area) * 2);
+    } else {
+      state->stats.violation_bytes[GC9A01_VIOLATION_OVERRUN] += total * 2;
     }
   }
+
+  if (state->opcode_timing && state->window_written >= state->window_area) {
+    end_opcode_timing(state);
+  }
+  if (count & 1) {
+    state->pending_data = data[count - 1];
+    state->pending_data_valid = true;
+  }
 }
 
 /*-----------------------------------------------------------
@@ -237,43 +1703,75 @@ static void gc9a01_spi_done(void *user_data, uint8_t *buffer, uint32_t count) {
   if (count == 0)
     return;
 
-  for (uint32_t i = 0; i < count; i++) {
-    uint8_t b = buffer[i];
+  if (state->trace_enabled) {
+    trace_record(state, GC9A01_TRACE_SPI, buffer, count);
+  }
+
+  state->stats.spi_done_calls++;
+  state->stats.bytes_received += count;
+
+  if (state->mode == GC9A01_MODE_DATA) {
+    uint32_t i = 0;
+    if (state->is_receiving_command) {
+      // Command parameters are sent with DC high.
+      uint32_t n = state->expected_args - state->received_args;
+      if (n > count) {
+        n = count;
+      }
+      memcpy(state->command_args + state->received_args, buffer, n);
+      state->received_args += n;
+      state->opcodes[state->current_command].bytes += n;
+      i = n;
+      if (state->received_args >= state->expected_args) {
+        process_command(state, state->current_command, state->command_args, state->expected_args);
+        state->is_receiving_command = false;
+        end_opcode_timing(state);
+      }
+    }
+    if (i < count && state->ram_write) {
+      state->opcodes[state->current_command].bytes += count - i;
+      process_pixel_data(state, buffer + i, count - i);
+    } else if (i < count && state->unmodelled_params) {
+      state->opcodes[state->current_command].bytes += count - i;
+    } else if (i < count) {
+      count_violation(state, GC9A01_VIOLATION_STRAY_DATA, count - i);
+    }
+  } else {
+    for (uint32_t i = 0; i < count; i++) {
+      uint8_t b = buffer[i];
 
-    if (state->mode == GC9A01_MODE_COMMAND) {
       if (!state->is_receiving_command) {
+        // Any command ends a memory write.
+        state->ram_write = false;
+        begin_opcode_timing(state);
         state->current_command = b;
         state->is_receiving_command = true;
         state->received_args = 0;
         state->expected_args = get_expected_arg_count(b);
-        if (state->expected_args == 0) {
+        state->unmodelled_params = state->expected_args == GC9A01_ARGS_UNTIL_COMMAND;
+        state->stats.commands[b]++;
+        state->opcodes[b].bytes++;
+        if (state->expected_args == 0 || state->unmodelled_params) {
           process_command(state, state->current_command, NULL, 0);
           state->is_receiving_command = false;
+          if (b != GC9A01_RAMWR && !state->unmodelled_params) {
+            end_opcode_timing(state);
+          }
         }
       } else {
         state->command_args[state->received_args++] = b;
+        state->opcodes[state->current_command].bytes++;
         if (state->received_args >= state->expected_args) {
           process_command(state, state->current_command, state->command_args, state->expected_args);
           state->is_receiving_command = false;
-        }
-      }
-    }
-    else { // Data mode.
-      if (state->ram_write) {
-        if (state->pending_data_valid) {
-          uint16_t pixel_val = (state->pending_data << 8) | b;
-          state->pending_data_valid = false;
-          process_pixel(state, pixel_val);
-        } else {
-          state->pending_data = b;
-          state->pending_data_valid = true;
+          end_opcode_timing(state);
         }
       }
     }
   }
 
   if (pin_read(state->cs_pin) == LOW) {
-    spi_start(state->spi, state->spi_buffer, 256);
+    spi_start(state->spi, state->spi_buffer, GC9A01_SPI_BUFFER_SIZE);
   }
 }
 
@@ -284,17 +1782,29 @@ static void gc9a01_spi_done(void *user_data, uint8_t *buffer, uint32_t count) {
 static void gc9a01_pin_change(void *user_data, pin_t pin, uint32_t value) {
   gc9a01_state_t *state = (gc9a01_state_t *)user_data;
 
+  // Process all the bytes received so far according to the old pin
+  // levels: spi_stop() hands them to gc9a01_spi_done().
+  spi_stop(state->spi);
+
+  if (state->trace_enabled) {
+    uint8_t trace_pin = pin == state->cs_pin ? GC9A01_TRACE_PIN_CS :
+                        pin == state->dc_pin ? GC9A01_TRACE_PIN_DC : GC9A01_TRACE_PIN_RST;
+    trace_record(state, GC9A01_TRACE_PIN | trace_pin << 1 | (value ? 1 : 0), NULL, 0);
+  }
+
   if (pin == state->cs_pin) {
-    if (value == LOW) {
-      state->is_receiving_command = false;
-      state->pending_data_valid = false;
-      spi_start(state->spi, state->spi_buffer, 256);
-    } else {
-      spi_stop(state->spi);
+    if (state->stats_enabled) {
+      track_cs_edge(state, value);
+    }
+    if (value == HIGH && state->ram_write && state->pending_data_valid) {
+      count_violation(state, GC9A01_VIOLATION_ODD_BYTE, 1);
+    }
+    if (value == HIGH) {
       state->ram_write = false;
-      state->is_receiving_command = false;
-      state->pending_data_valid = false;
+      end_opcode_timing(state);
     }
+    state->is_receiving_command = false;
+    state->pending_data_valid = false;
   }
 
   if (pin == state->dc_pin) {
@@ -302,31 +1812,28 @@ static void gc9a01_pin_change(void *user_data, pin_t pin, uint32_t value) {
       state->mode = GC9A01_MODE_COMMAND;
     else
       state->mode = GC9A01_MODE_DATA;
-
-    spi_stop(state->spi);
-    if (pin_read(state->cs_pin) == LOW)
-      spi_start(state->spi, state->spi_buffer, 256);
   }
 
   if (pin == state->rst_pin && value == LOW) {
-    spi_stop(state->spi);
-    uint32_t black = 0xff000000;
-    for (uint32_t y = 0; y < state->height; y++) {
-      for (uint32_t x = 0; x < state->width; x++) {
-        uint32_t offset = (y * state->width + x) * 4;
-        buffer_write(state->framebuffer, offset, &black, sizeof(black));
-      }
-    }
+    clear_panel(state);
     state->display_on = false;
     state->inverted = false;
+    state->madctl = 0;
+    state->colmod = 0;
     state->ram_write = false;
+    state->unmodelled_params = false;
     state->col_start = 0;
     state->col_end = state->width - 1;
     state->row_start = 0;
     state->row_end = state->height - 1;
     state->current_col = 0;
     state->current_row = 0;
+    state->window_set = 0;
+    clip_window(state);
   }
+
+  if (pin_read(state->cs_pin) == LOW)
+    spi_start(state->spi, state->spi_buffer, GC9A01_SPI_BUFFER_SIZE);
 }
 
 /*-----------------------------------------------------------
@@ -355,6 +1862,7 @@ void chip_init(void) {
   state->row_end   = state->height - 1;
   state->current_col = 0;
   state->current_row = 0;
+  clip_window(state);
 
   state->cs_pin  = pin_init("CS", INPUT_PULLUP);
   state->dc_pin  = pin_init("DC", INPUT);
@@ -362,6 +1870,33 @@ void chip_init(void) {
   pin_init("SCL", INPUT_PULLUP);
   pin_init("SDA", INPUT_PULLUP);
 
+  state->framebuffer = framebuffer_init(&state->width, &state->height);
+
+  if (!init_mask(state)) {
+    printf("GC9A01: Failed to allocate mask memory!\n");
+    return;
+  }
+
+  // presented starts out transparent, so the first refresh sends every pixel.
+  state->shadow      = calloc(state->width * state->height, sizeof(uint32_t));
+  state->presented   = calloc(state->width * state->height, sizeof(uint32_t));
+  state->dirty_left  = calloc(state->height, sizeof(uint16_t));
+  state->dirty_right = calloc(state->height, sizeof(uint16_t));
+  state->row_generation = calloc(state->height, sizeof(uint32_t));
+  state->cover_left  = calloc(state->height, sizeof(uint16_t));
+  state->cover_right = calloc(state->height, sizeof(uint16_t));
+  if (!state->shadow || !state->presented || !state->dirty_left || !state->dirty_right ||
+      !state->row_generation || !state->cover_left || !state->cover_right) {
+    printf("GC9A01: Failed to allocate framebuffer memory!\n");
+    return;
+  }
+  for (uint32_t y = 0; y < state->height; y++) {
+    state->dirty_left[y] = 0xffff;
+  }
+  state->dirty_top = 0xffff;
+  state->dirty_bottom = 0;
+
+  // Only now that the chip's memory is in place can it take callbacks.
   const pin_watch_config_t watch_config = {
     .edge = BOTH,
     .pin_change = gc9a01_pin_change,
@@ -380,15 +1915,85 @@ void chip_init(void) {
   };
   state->spi = spi_init(&spi_conf);
 
-  state->framebuffer = framebuffer_init(&state->width, &state->height);
+  // The initial clear and presentation happen right away.
+  state->slice_pixels = UINT32_MAX;
+  clear_panel(state);
+  begin_present(state, state->shadow);
+  run_background(state);
 
-  uint32_t black = 0xff000000;
-  for (uint32_t y = 0; y < state->height; y++) {
-    for (uint32_t x = 0; x < state->width; x++) {
-      uint32_t offset = (y * state->width + x) * 4;
-      buffer_write(state->framebuffer, offset, &black, sizeof(black));
+  uint32_t slice_pixels = attr_read(attr_init("slice_pixels", GC9A01_DEFAULT_SLICE_PIXELS));
+  state->slice_pixels = slice_pixels ? slice_pixels : UINT32_MAX;
+
+  if (attr_read(attr_init("frame_crc", 0))) {
+    state->row_crc = calloc(state->height, sizeof(uint32_t));
+    if (state->row_crc) {
+      init_crc_table();
+      init_row_shift(state);
+      for (uint32_t y = 0; y < state->height; y++) {
+        update_row_crc(state, y);
+      }
+      state->crc_enabled = true;
+    } else {
+      printf("GC9A01: Failed to allocate CRC memory, frame_crc is off!\n");
     }
   }
 
+  if (attr_read(attr_init("trace", 0))) {
+    init_trace(state);
+  }
+
+  if (attr_read(attr_init("dead_writes", 0))) {
+    state->write_counts = calloc(state->width * state->height, sizeof(uint8_t));
+    if (state->write_counts) {
+      state->dead_writes_enabled = true;
+      state->counting_writes = true;
+    } else {
+      printf("GC9A01: Failed to allocate dead-write memory, dead_writes is off!\n");
+    }
+  }
+
+  state->heatmap_attr = attr_init("overdraw_heatmap", 0);
+  state->dump_opcodes_attr = attr_init("dump_opcodes", 0);
+  state->dump_opcodes_value = attr_read(state->dump_opcodes_attr);
+
+  uint32_t refresh_rate = attr_read(attr_init("refresh_rate", GC9A01_DEFAULT_REFRESH_RATE));
+  if (refresh_rate == 0) {
+    refresh_rate = GC9A01_DEFAULT_REFRESH_RATE;
+  }
+  const timer_config_t timer_config = {
+    .callback = gc9a01_refresh,
+    .user_data = state,
+  };
+  state->refresh_timer = timer_init(&timer_config);
+  timer_start(state->refresh_timer, 1000000 / refresh_rate, true);
+
+  const timer_config_t slice_timer_config = {
+    .callback = gc9a01_slice,
+    .user_data = state,
+  };
+  state->slice_timer = timer_init(&slice_timer_config);
+
+  uint32_t stats_interval = attr_read(attr_init("stats_interval", 0));
+  if (stats_interval > 0) {
+    const timer_config_t stats_timer_config = {
+      .callback = gc9a01_report_stats,
+      .user_data = state,
+    };
+    state->stats_timer = timer_init(&stats_timer_config);
+    state->stats_reported_ns = get_sim_nanos();
+    timer_start(state->stats_timer, stats_interval * 1000, true);
+    state->stats_enabled = true;
+  }
+
+  uint32_t opcode_interval = attr_read(attr_init("opcode_interval", 0));
+  if (opcode_interval > 0) {
+    const timer_config_t opcode_timer_config = {
+      .callback = gc9a01_report_opcodes,
+      .user_data = state,
+    };
+    state->opcode_timer = timer_init(&opcode_timer_config);
+    timer_start(state->opcode_timer, opcode_interval * 1000, true);
+  }
+
   printf("GC9A01 1.2\" 240x240 Rounded Display initialized!\n");
 }
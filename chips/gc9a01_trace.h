@@ -0,0 +1,76 @@
+// GC9A01 SPI/pin event trace format
+//
+// With the "trace" attribute set, the GC9A01 chip streams a compact
+// binary log of everything it receives out of its TRACE pin (UART, 8N1).
+// The same format is read back by the native replay tools.
+//
+// Stream layout:
+//   header   8 bytes: "GC9ATRC" followed by the format version (1)
+//   records  one tag byte followed by the record fields
+//
+// Every record starts with the time since the previous record in
+// nanoseconds of simulation time, as an unsigned LEB128 varint.
+//
+//   0x10 | pin << 1 | value   pin edge: pin is 0 = CS, 1 = DC, 2 = RST
+//       varint delta_ns
+//   0x20                      SPI chunk, exactly as passed to spi_done
+//       varint delta_ns, varint length, length bytes
+//   0x30                      overflow: records were dropped because
+//       varint delta_ns,      the UART could not keep up
+//       varint dropped_records
+//
+// Pin edges are recorded after the SPI bytes received before them, so
+// replaying records in order reproduces what the chip saw.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef GC9A01_TRACE_H
+#define GC9A01_TRACE_H
+
+#include <stdint.h>
+
+#define GC9A01_TRACE_MAGIC        "GC9ATRC"
+#define GC9A01_TRACE_VERSION      1
+#define GC9A01_TRACE_HEADER_SIZE  8
+
+#define GC9A01_TRACE_PIN          0x10
+#define GC9A01_TRACE_SPI          0x20
+#define GC9A01_TRACE_OVERFLOW     0x30
+
+#define GC9A01_TRACE_PIN_CS       0
+#define GC9A01_TRACE_PIN_DC       1
+#define GC9A01_TRACE_PIN_RST      2
+
+#define GC9A01_TRACE_VARINT_MAX   10
+
+/*-----------------------------------------------------------
+   Append an unsigned LEB128 varint; returns the bytes written.
+-----------------------------------------------------------*/
+static inline uint32_t gc9a01_trace_put_varint(uint8_t *out, uint64_t value) {
+  uint32_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+/*-----------------------------------------------------------
+   Read an unsigned LEB128 varint from [*in, end). Returns 0 on a
+   truncated or oversized varint.
+-----------------------------------------------------------*/
+static inline int gc9a01_trace_get_varint(const uint8_t **in, const uint8_t *end, uint64_t *value) {
+  uint64_t result = 0;
+  for (uint32_t shift = 0; *in < end && shift < 64; shift += 7) {
+    uint8_t b = *(*in)++;
+    result |= (uint64_t)(b & 0x7f) << shift;
+    if (!(b & 0x80)) {
+      *value = result;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#endif /* GC9A01_TRACE_H */
@@ -0,0 +1,291 @@
+// GC9A01 native benchmark: canonical workloads for judging changes to the chip
+//
+//   gc9a01-bench [-v] [-p] [-a name=value]... [-n frames] [-c spi_hz] [workload]...
+//
+// The chip's own output is discarded unless -v is given; -p prints the
+// host import profile (see host_print_profile) after each workload.
+//
+// Runs each workload (all of them by default) against a fresh chip and
+// prints, per workload:
+//   MB/s      SPI bytes ingested per second of CPU time
+//   Mpx/s     pixels sent per second of CPU time
+//   bw/frame  host buffer_write calls per workload frame
+//   imp/frame host import calls of any kind (wasm boundary crossings in
+//             the simulator) per workload frame
+//   ns/byte   CPU time per SPI byte
+//
+// The chip runs with its default attributes, so presentation is sliced
+// as in the simulator; -a slice_pixels=0 measures whole-frame presents.
+//
+// Workloads (one "frame" each is one application update, paced at the
+// workload's frame rate in simulated time):
+//   fill      fillScreen with a new color (60 fps)
+//   pixels    2000 random 1x1 drawPixel calls (60 fps)
+//   text      a screen of 6x8 text in size 1 and 2 with a background color,
+//             sent like Adafruit_GFX drawChar: one pixel (size 1) or one
+//             fillRect (size 2) per glyph dot (10 fps)
+//   lvgl      LVGL partial redraws through a 25% (14400 px) draw buffer, as
+//             with buffer_size: 25% in roundlcd.yaml: a moving 100x100 image
+//             plus a label every frame, the full screen every 30th (30 fps)
+//   video     full 240x240 RGB565 frames in one window (30 fps)
+//   rotated   fills with MADCTL cycling through the four rotations (60 fps)
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "host.h"
+#include "driver.h"
+
+#define BENCH_WIDTH   240
+#define BENCH_HEIGHT  240
+
+#define LVGL_BUFFER_PIXELS  (BENCH_WIDTH * BENCH_HEIGHT / 4)
+
+void chip_init(void);
+
+typedef struct {
+  const char *name;
+  uint32_t fps;
+  void (*frame)(uint32_t frame);
+} workload_t;
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void) {
+  rng_state = rng_state * 1103515245 + 12345;
+  return rng_state >> 8;
+}
+
+static uint16_t pixels[BENCH_WIDTH * BENCH_HEIGHT];
+
+/*-----------------------------------------------------------
+   Workloads
+-----------------------------------------------------------*/
+static void fill_frame(uint32_t frame) {
+  drv_fill_rect(0, 0, BENCH_WIDTH, BENCH_HEIGHT, (uint16_t)(frame * 0x0841));
+}
+
+static void pixels_frame(uint32_t frame) {
+  (void)frame;
+  for (uint32_t i = 0; i < 2000; i++) {
+    uint32_t r = rng();
+    drv_draw_pixel(r % BENCH_WIDTH, (r >> 8) % BENCH_HEIGHT, (uint16_t)rng());
+  }
+}
+
+// Stand-in 5x7 glyph dots: only which dots are set differs from a real
+// font, the traffic (every dot of the 6x8 cell, fg or bg) is the same.
+static bool glyph_dot(char c, uint32_t col, uint32_t row) {
+  if (col >= 5 || row >= 7 || c == ' ') {
+    return false;
+  }
+  uint32_t bits = (uint32_t)c * 2654435761u;
+  return (bits >> ((col * 7 + row) % 31)) & 1;
+}
+
+static void draw_char(uint16_t x, uint16_t y, char c, uint16_t color, uint16_t bg, uint16_t size) {
+  drv_start_write();
+  for (uint32_t col = 0; col < 6; col++) {
+    for (uint32_t row = 0; row < 8; row++) {
+      uint16_t dot = glyph_dot(c, col, row) ? color : bg;
+      uint16_t px = x + col * size;
+      uint16_t py = y + row * size;
+      if (px + size > BENCH_WIDTH || py + size > BENCH_HEIGHT) {
+        continue;
+      }
+      drv_set_window(px, py, px + size - 1, py + size - 1);
+      drv_write_color(dot, (uint32_t)size * size);
+    }
+  }
+  drv_end_write();
+}
+
+static void text_frame(uint32_t frame) {
+  static const char text[] = "The quick brown fox jumps over the lazy dog 0123456789";
+  uint32_t n = frame;
+  uint16_t y = 0;
+  for (uint16_t size = 1; size <= 2; size++) {
+    for (uint32_t line = 0; line < (size == 1 ? 15 : 7); line++) {
+      for (uint16_t x = 0; x + 6 * size <= BENCH_WIDTH; x += 6 * size) {
+        draw_char(x, y, text[n++ % (sizeof(text) - 1)], 0xffff, (uint16_t)(frame * 0x1863), size);
+      }
+      y += 8 * size;
+    }
+  }
+}
+
+// One LVGL flush: the area goes out in slices of at most the draw
+// buffer, each as one window and one pixel transfer.
+static void lvgl_flush(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint32_t frame) {
+  uint16_t rows = LVGL_BUFFER_PIXELS / w;
+  for (uint16_t top = y; top < y + h; top += rows) {
+    uint16_t n = top + rows <= y + h ? rows : y + h - top;
+    for (uint32_t i = 0; i < (uint32_t)w * n; i++) {
+      pixels[i] = (uint16_t)(i * 7 + frame * 0x0821 + top);
+    }
+    drv_start_write();
+    drv_set_window(x, top, x + w - 1, top + n - 1);
+    drv_write_pixels(pixels, (uint32_t)w * n);
+    drv_end_write();
+  }
+}
+
+static void lvgl_frame(uint32_t frame) {
+  if (frame % 30 == 0) {
+    lvgl_flush(0, 0, BENCH_WIDTH, BENCH_HEIGHT, frame);
+    return;
+  }
+  // The image moved by 4 px: LVGL redraws the union of both positions.
+  uint16_t x = 20 + (frame * 4) % 116;
+  uint16_t left = x >= 4 ? x - 4 : x;
+  lvgl_flush(left, 40, x + 100 - left, 100, frame);
+  lvgl_flush(70, 200, 100, 16, frame);
+}
+
+static void video_frame(uint32_t frame) {
+  for (uint32_t i = 0; i < BENCH_WIDTH * BENCH_HEIGHT; i++) {
+    pixels[i] = (uint16_t)((i % BENCH_WIDTH + frame) * 0x0841 ^ (i / BENCH_WIDTH) * 0x0020);
+  }
+  drv_start_write();
+  drv_set_window(0, 0, BENCH_WIDTH - 1, BENCH_HEIGHT - 1);
+  drv_write_pixels(pixels, BENCH_WIDTH * BENCH_HEIGHT);
+  drv_end_write();
+}
+
+static void rotated_frame(uint32_t frame) {
+  static const uint8_t rotations[4] = { 0x48, 0x28, 0x88, 0xe8 };   // Adafruit setRotation 0..3
+  drv_command(0x36, &rotations[frame % 4], 1);
+  drv_fill_rect(0, 0, BENCH_WIDTH, BENCH_HEIGHT, (uint16_t)(frame * 0x0841));
+  drv_fill_rect(40, 60, 160, 40, 0xffff);
+}
+
+static const workload_t workloads[] = {
+  { "fill",    60, fill_frame },
+  { "pixels",  60, pixels_frame },
+  { "text",    10, text_frame },
+  { "lvgl",    30, lvgl_frame },
+  { "video",   30, video_frame },
+  { "rotated", 60, rotated_frame },
+};
+
+/*-----------------------------------------------------------
+   Run one workload on a fresh chip and print its line.
+-----------------------------------------------------------*/
+static uint32_t spi_clock = HOST_DEFAULT_SPI_CLOCK;
+static FILE *out;
+static bool profile;
+
+static void run(const workload_t *workload, uint32_t frames) {
+  host_reset();
+  host_set_spi_clock(spi_clock);
+  host_apply_attrs();
+  chip_init();
+  drv_begin();
+  rng_state = 1;
+
+  host_stats_t before = *host_stats();
+  uint64_t pixels_before = drv_pixel_count();
+  uint64_t period = 1000000000ull / workload->fps;
+  double start = host_cpu_seconds();
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    uint64_t frame_start = host_now();
+    workload->frame(frame);
+    host_run_until(frame_start + period);
+  }
+  double cpu = host_cpu_seconds() - start;
+
+  const host_stats_t *after = host_stats();
+  uint64_t bytes = after->spi_bytes - before.spi_bytes;
+  uint64_t px = drv_pixel_count() - pixels_before;
+  fprintf(out, "%-8s %6u %10.1f %9.2f %9.1f %9.1f %10.2f %9.3f\n",
+          workload->name, frames,
+          cpu > 0 ? bytes / cpu / 1e6 : 0.0,
+          cpu > 0 ? px / cpu / 1e6 : 0.0,
+          (double)(after->buffer_writes - before.buffer_writes) / frames,
+          (double)(after->import_calls - before.import_calls) / frames,
+          bytes ? cpu * 1e9 / bytes : 0.0,
+          cpu);
+  if (profile) {
+    host_print_profile(out);
+    fprintf(out, "\n");
+  }
+  fflush(out);
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: gc9a01-bench [-v] [-p] [-a name=value]... [-n frames] [-c spi_hz] [workload]...\n");
+  fprintf(stderr, "workloads:");
+  for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+    fprintf(stderr, " %s", workloads[i].name);
+  }
+  fprintf(stderr, "\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  uint32_t frames = 300;
+  const workload_t *selected[sizeof(workloads) / sizeof(workloads[0])];
+  uint32_t selected_count = 0;
+  bool verbose = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      if (!host_parse_attr(argv[++i])) {
+        usage();
+      }
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[i], "-p") == 0) {
+      profile = true;
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      frames = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      spi_clock = strtoul(argv[++i], NULL, 0);
+    } else {
+      const workload_t *found = NULL;
+      for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        if (strcmp(argv[i], workloads[w].name) == 0) {
+          found = &workloads[w];
+        }
+      }
+      if (!found || selected_count == sizeof(selected) / sizeof(selected[0])) {
+        usage();
+      }
+      selected[selected_count++] = found;
+    }
+  }
+  if (frames == 0) {
+    usage();
+  }
+  if (selected_count == 0) {
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+      selected[selected_count++] = &workloads[w];
+    }
+  }
+
+  // The table keeps the real stdout; the chip's printf goes to
+  // /dev/null unless -v.
+  out = fdopen(dup(STDOUT_FILENO), "w");
+  if (!out) {
+    perror("gc9a01-bench");
+    return 1;
+  }
+  if (!verbose) {
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0) {
+      dup2(null, STDOUT_FILENO);
+      close(null);
+    }
+  }
+
+  fprintf(out, "%-8s %6s %10s %9s %9s %9s %10s %9s\n", "workload", "frames", "MB/s", "Mpx/s", "bw/frame",
+          "imp/frame", "ns/byte", "cpu s");
+  for (uint32_t i = 0; i < selected_count; i++) {
+    run(selected[i], frames);
+  }
+  return 0;
+}
@@ -0,0 +1,402 @@
+// GC9A01 differential checker: the chip against the reference model
+//
+//   gc9a01-check [-a name=value]... [-c chunk_bytes] trace.bin...
+//   gc9a01-check [-a name=value]... -r [-q] [-s seed] [-n steps]
+//
+// Runs the chip and the plain per-pixel reference model (reference.c) on
+// the same input and compares their framebuffers byte for byte, either at
+// the end of each trace or, with -r, at checkpoints of a random command
+// stream. The random stream deliberately includes what drivers get wrong:
+// windows past the panel edge or inverted, overruns, odd byte counts,
+// CS and DC toggled mid-transfer, stray data, resets and random SPI chunk
+// boundaries. With -q the stream is queued as host events instead
+// (host_schedule_pin/host_schedule_spi), with SPI chunks arriving while
+// the previous one is still on the bus, and the chip must also see the
+// bytes in the order they were queued.
+//
+// Exits with status 1 at the first difference.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "driver.h"
+#include "reference.h"
+#include "trace.h"
+
+#define CHECK_INTERVAL      50            // Random steps between comparisons
+#define CHECK_BYTE_NS       (8 * 1000000000ull / HOST_DEFAULT_SPI_CLOCK)
+
+void chip_init(void);
+
+
+/* -q: input is queued at queue_ns; SPI bytes queued but not yet seen by
+   the chip, to check their order */
+static bool queued;
+static uint64_t queue_ns;
+static uint8_t *queued_bytes;
+static size_t queued_len, queued_capacity, queued_seen;
+static bool out_of_order;
+
+static void check_order(const uint8_t *data, uint32_t count) {
+  if (queued_seen + count > queued_len || memcmp(queued_bytes + queued_seen, data, count) != 0) {
+    out_of_order = true;
+  }
+  queued_seen += count;
+  ref_spi(data, count);
+}
+
+static void start_chip(void) {
+  host_reset();
+  host_apply_attrs();
+  host_set_attr("overdraw_heatmap", 0);
+  chip_init();
+
+  uint32_t width, height;
+  host_framebuffer(&width, &height);
+  ref_init(width, height);
+  const host_observer_t observer = {
+    .pin = ref_pin,
+    .spi = queued ? check_order : ref_spi,
+  };
+  host_set_observer(&observer);
+}
+
+/*-----------------------------------------------------------
+   Compare the presented framebuffer with the reference; print the
+   first difference. The chip settles first, stopping early once the
+   framebuffer matches.
+-----------------------------------------------------------*/
+static bool matches(void) {
+  uint32_t width, height;
+  const uint32_t *chip = host_framebuffer(&width, &height);
+  return memcmp(chip, ref_framebuffer(), (size_t)width * height * 4) == 0;
+}
+
+static bool compare(const char *what) {
+  host_settle(matches);
+  if (matches()) {
+    return true;
+  }
+
+  uint32_t width, height;
+  const uint32_t *chip = host_framebuffer(&width, &height);
+  const uint32_t *ref = ref_framebuffer();
+
+  uint32_t first = 0;
+  uint32_t differ = 0;
+  for (uint32_t i = width * height; i-- > 0;) {
+    if (chip[i] != ref[i]) {
+      first = i;
+      differ++;
+    }
+  }
+  fprintf(stderr, "%s: framebuffer differs in %u pixels, first at (%u,%u): chip %08x, reference %08x\n",
+         what, differ, first % width, first / width, chip[first], ref[first]);
+  return false;
+}
+
+/*-----------------------------------------------------------
+   Random command stream
+-----------------------------------------------------------*/
+static uint64_t rng_state;
+
+static uint32_t rng(void) {
+  rng_state = rng_state * 6364136223846793005ull + 1442695040888963407ull;
+  return rng_state >> 33;
+}
+
+static uint32_t below(uint32_t n) {
+  return rng() % n;
+}
+
+static void set_pin(const char *name, uint32_t value) {
+  if (queued) {
+    host_schedule_pin(queue_ns, name, value);
+  } else {
+    host_set_pin(name, value);
+  }
+}
+
+static void delay(uint64_t ns) {
+  if (queued) {
+    queue_ns += ns;
+  } else {
+    host_advance(ns);
+  }
+}
+
+// Queue random-size chunks, each due while the one before it is still
+// on the bus; the input after them is due once the bus is free.
+static void send_queued(const uint8_t *data, uint32_t len) {
+  if (queued_len + len > queued_capacity) {
+    queued_capacity = (queued_len + len) * 2;
+    queued_bytes = realloc(queued_bytes, queued_capacity);
+    if (!queued_bytes) {
+      fprintf(stderr, "out of memory\n");
+      exit(2);
+    }
+  }
+  memcpy(queued_bytes + queued_len, data, len);
+  queued_len += len;
+
+  uint64_t end = queue_ns + len * CHECK_BYTE_NS;
+  while (len > 0) {
+    uint32_t n = 1 + below(len < 700 ? len : 700);
+    host_schedule_spi(queue_ns, data, n);
+    queue_ns += below(n * CHECK_BYTE_NS + 1);
+    data += n;
+    len -= n;
+  }
+  queue_ns = end;
+}
+
+// Send bytes either clocked in (host chunking) or as random-size chunks.
+static void send(const uint8_t *data, uint32_t len) {
+  if (queued) {
+    send_queued(data, len);
+    return;
+  }
+  if (below(2)) {
+    host_spi_send(data, len);
+    return;
+  }
+  while (len > 0) {
+    uint32_t n = 1 + below(len < 700 ? len : 700);
+    uint32_t taken = host_spi_deliver(data, n, false);
+    if (taken == 0) {
+      return;
+    }
+    data += taken;
+    len -= taken;
+  }
+}
+
+static void command(uint8_t cmd, const uint8_t *args, uint32_t len) {
+  set_pin("DC", 0);
+  send(&cmd, 1);
+  // Parameters normally go with DC high, but DC low works too.
+  set_pin("DC", below(8) != 0);
+  if (len > 0) {
+    send(args, len);
+  }
+}
+
+static uint16_t coordinate(void) {
+  uint32_t r = below(16);
+  return r == 0 ? 240 + below(60) : r == 1 ? 0xffff - below(4) : below(240);
+}
+
+static void random_pixels(uint32_t pixels) {
+  static uint8_t data[240 * 240 * 2 + 1];
+  uint32_t bytes = pixels * 2 + (below(8) == 0);
+  if (bytes > sizeof(data)) {
+    bytes = sizeof(data);
+  }
+  uint16_t color = rng();
+  bool solid = below(2);
+  for (uint32_t i = 0; i < bytes; i += 2) {
+    uint16_t c = solid ? color : (uint16_t)rng();
+    data[i] = c >> 8;
+    if (i + 1 < bytes) {
+      data[i + 1] = c & 0xff;
+    }
+  }
+  set_pin("DC", 1);
+  send(data, bytes);
+}
+
+static void random_step(void) {
+  set_pin("CS", 0);
+  switch (below(20)) {
+    case 0: case 1: case 2: case 3: case 4: case 5: {
+      // Window and pixels: exact, short or overrunning.
+      uint16_t x0 = coordinate(), x1 = coordinate(), y0 = coordinate(), y1 = coordinate();
+      if (below(4)) {
+        if (x0 > x1) { uint16_t t = x0; x0 = x1; x1 = t; }
+        if (y0 > y1) { uint16_t t = y0; y0 = y1; y1 = t; }
+      }
+      uint8_t caset[4] = { x0 >> 8, x0 & 0xff, x1 >> 8, x1 & 0xff };
+      uint8_t raset[4] = { y0 >> 8, y0 & 0xff, y1 >> 8, y1 & 0xff };
+      command(0x2A, caset, 4);
+      command(0x2B, raset, 4);
+      command(0x2C, NULL, 0);
+      uint32_t area = x0 <= x1 && y0 <= y1 ? (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1) : 64;
+      if (area > 240 * 240) {
+        area = 240 * 240;
+      }
+      uint32_t r = below(4);
+      random_pixels(r == 0 ? below(area + 1) : r == 1 ? area + below(area + 1) : area);
+      break;
+    }
+    case 6: case 7: case 8: {
+      uint16_t x = below(240), y = below(240);
+      uint8_t caset[4] = { x >> 8, x & 0xff, x >> 8, x & 0xff };
+      uint8_t raset[4] = { y >> 8, y & 0xff, y >> 8, y & 0xff };
+      command(0x2A, caset, 4);
+      command(0x2B, raset, 4);
+      command(0x2C, NULL, 0);
+      random_pixels(1 + (below(4) == 0) * below(4));
+      break;
+    }
+    case 9:
+      // Continue the current RAMWR (or send stray data if there is none).
+      random_pixels(below(2000));
+      break;
+    case 10:
+      command(below(2) ? 0x20 : 0x21, NULL, 0);
+      break;
+    case 11: {
+      uint8_t arg = rng();
+      command(below(2) ? 0x36 : 0x3A, &arg, 1);
+      break;
+    }
+    case 12: {
+      // Unknown command, maybe with stray data after it.
+      uint8_t junk[8];
+      for (uint32_t i = 0; i < sizeof(junk); i++) {
+        junk[i] = rng();
+      }
+      command(0x40 + below(0x40), junk, below(9));
+      break;
+    }
+    case 13:
+      if (below(8) == 0) {
+        command(0x01, NULL, 0);
+      }
+      break;
+    case 14:
+      if (below(16) == 0) {
+        set_pin("RST", 0);
+        delay(10000);
+        set_pin("RST", 1);
+      }
+      break;
+    case 15:
+      // CS pulse mid-transfer.
+      set_pin("CS", 1);
+      set_pin("CS", 0);
+      break;
+    case 16:
+      // Partial command parameters, then something else.
+      set_pin("DC", 0);
+      send((const uint8_t[]){ below(2) ? 0x2A : 0x2B, 0 }, 1 + below(2));
+      break;
+    default:
+      delay(below(20000000));
+      break;
+  }
+  if (below(3) == 0) {
+    set_pin("CS", 1);
+  }
+}
+
+/*-----------------------------------------------------------
+   Run the queued input and check the chip saw the bytes in order.
+   Bytes still in the chip's SPI buffer are checked next time.
+-----------------------------------------------------------*/
+static bool check_queued(const char *what) {
+  host_run_until(queue_ns);
+  if (out_of_order) {
+    fprintf(stderr, "%s: the chip did not see the queued SPI bytes in order\n", what);
+    return false;
+  }
+  memmove(queued_bytes, queued_bytes + queued_seen, queued_len - queued_seen);
+  queued_len -= queued_seen;
+  queued_seen = 0;
+  return true;
+}
+
+static bool check_random(uint64_t seed, uint32_t steps) {
+  start_chip();
+  rng_state = seed;
+  drv_begin();
+  // The init sequence is sent directly, not queued.
+  queued_seen = 0;
+  out_of_order = false;
+  queue_ns = host_now();
+  for (uint32_t step = 1; step <= steps; step++) {
+    random_step();
+    if (step % CHECK_INTERVAL == 0 || step == steps) {
+      char what[64];
+      snprintf(what, sizeof(what), "seed %llu step %u", (unsigned long long)seed, step);
+      if (queued && !check_queued(what)) {
+        return false;
+      }
+      if (!compare(what)) {
+        return false;
+      }
+      queue_ns = host_now();
+    }
+  }
+  printf("seed %llu: %u steps match\n", (unsigned long long)seed, steps);
+  return true;
+}
+
+static bool check_trace(const char *path, uint32_t chunk_size) {
+  start_chip();
+  trace_stats_t stats;
+  if (!trace_replay(path, chunk_size, &stats)) {
+    return false;
+  }
+  if (!compare(path)) {
+    return false;
+  }
+  printf("%s: match (%llu records)\n", path, (unsigned long long)stats.records);
+  return true;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: gc9a01-check [-a name=value]... [-c chunk_bytes] trace.bin...\n");
+  fprintf(stderr, "       gc9a01-check [-a name=value]... -r [-q] [-s seed] [-n steps]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  bool random = false;
+  uint64_t seed = 1;
+  uint32_t steps = 2000;
+  uint32_t chunk_size = 0;
+  int traces = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      if (!host_parse_attr(argv[++i])) {
+        usage();
+      }
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      chunk_size = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-r") == 0) {
+      random = true;
+    } else if (strcmp(argv[i], "-q") == 0) {
+      queued = true;
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      steps = strtoul(argv[++i], NULL, 0);
+    } else if (argv[i][0] != '-') {
+      traces++;
+    } else {
+      usage();
+    }
+  }
+  if (random == (traces > 0) || (queued && !random)) {
+    usage();
+  }
+
+  if (random) {
+    return check_random(seed, steps) ? 0 : 1;
+  }
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] == '-') {
+      i += strcmp(argv[i], "-r") != 0 && strcmp(argv[i], "-q") != 0;
+      continue;
+    }
+    if (!check_trace(argv[i], chunk_size)) {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,106 @@
+// GC9A01 native demo: run the chip outside the simulator
+//
+// Initializes the panel like the Adafruit library, then fills the screen
+// with a different color once per frame and prints what it cost.
+//
+//   gc9a01-demo [-a name=value]... [-p] [-t trace.bin] [-d image] [-y video.y4m] [frames]
+//
+// -a sets a chip attribute (see chips/gc9a01.c), e.g. -a stats_interval=1000.
+// -p prints the host import profile (see host_print_profile) at the end.
+// -t records the chip's event trace (see gc9a01-replay) to trace.bin.
+// -d writes the final framebuffer to image (.ppm or .png), or every
+// presented frame if image is a pattern like frame-%05u.png; -y streams
+// the presented frames into a Y4M video (see dump.h).
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "dump.h"
+#include "driver.h"
+
+void chip_init(void);
+
+static void usage(void) {
+  fprintf(stderr, "usage: gc9a01-demo [-a name=value]... [-p] [-t trace.bin] [-d image] [-y video.y4m] [frames]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  uint32_t frames = 60;
+  FILE *trace = NULL;
+  bool profile = false;
+  const char *image = NULL;
+  host_present_whole_frames();
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      if (!host_parse_attr(argv[++i])) {
+        usage();
+      }
+    } else if (strcmp(argv[i], "-p") == 0) {
+      profile = true;
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      trace = fopen(argv[++i], "wb");
+      if (!trace) {
+        perror(argv[i]);
+        return 1;
+      }
+      host_set_attr("trace", 1);
+      host_set_uart_output(trace);
+    } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      image = argv[++i];
+      if (strchr(image, '%') && !dump_frames(image)) {
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-y") == 0 && i + 1 < argc) {
+      if (!dump_video(argv[++i], DUMP_VIDEO_FPS)) {
+        return 1;
+      }
+    } else if (argv[i][0] != '-') {
+      frames = strtoul(argv[i], NULL, 0);
+    } else {
+      usage();
+    }
+  }
+
+  const host_observer_t observer = {
+    .present = dump_present,
+  };
+  host_set_observer(&observer);
+  host_apply_attrs();
+  chip_init();
+  drv_begin();
+
+  double start = host_cpu_seconds();
+  uint64_t sim_start = host_now();
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    drv_fill_rect(0, 0, 240, 240, (uint16_t)(frame * 0x0841));
+    host_advance(1000000000ull / 60);
+  }
+  double wall = host_cpu_seconds() - start;
+  double sim = (host_now() - sim_start) / 1e9;
+  if (trace) {
+    // Let the refreshes send the rest of the trace.
+    host_advance(100000000);
+    fclose(trace);
+  }
+  if (image && !strchr(image, '%')) {
+    dump_image(image);
+  }
+  dump_close();
+
+  const host_stats_t *stats = host_stats();
+  printf("%u frames: %.3fs sim time in %.3fs CPU (%.0fx real time)\n",
+         frames, sim, wall, wall > 0 ? sim / wall : 0.0);
+  printf("%llu SPI bytes in %llu chunks (%llu dropped), %llu buffer_write calls (%llu bytes), %llu timer callbacks\n",
+         (unsigned long long)stats->spi_bytes, (unsigned long long)stats->spi_chunks,
+         (unsigned long long)stats->spi_dropped, (unsigned long long)stats->buffer_writes,
+         (unsigned long long)stats->buffer_bytes, (unsigned long long)stats->timer_callbacks);
+  printf("framebuffer crc %08x\n", host_framebuffer_crc());
+  if (profile) {
+    host_print_profile(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,125 @@
+// Host-side GC9A01 driver for the native harness
+//
+// SPDX-License-Identifier: MIT
+
+#include <stddef.h>
+#include "driver.h"
+#include "host.h"
+
+#define DRV_CHUNK  512   // Pixels staged per host_spi_send()
+
+static uint64_t pixels_sent;
+
+void drv_start_write(void) {
+  host_set_pin("CS", 0);
+}
+
+void drv_end_write(void) {
+  host_set_pin("CS", 1);
+}
+
+void drv_write_command(uint8_t command, const uint8_t *args, uint32_t len) {
+  host_set_pin("DC", 0);
+  host_spi_send(&command, 1);
+  host_set_pin("DC", 1);
+  if (len > 0) {
+    host_spi_send(args, len);
+  }
+}
+
+void drv_write_data(const uint8_t *data, uint32_t len) {
+  host_set_pin("DC", 1);
+  host_spi_send(data, len);
+}
+
+void drv_set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+  const uint8_t caset[4] = { x0 >> 8, x0 & 0xff, x1 >> 8, x1 & 0xff };
+  const uint8_t raset[4] = { y0 >> 8, y0 & 0xff, y1 >> 8, y1 & 0xff };
+  drv_write_command(0x2A, caset, 4);
+  drv_write_command(0x2B, raset, 4);
+  drv_write_command(0x2C, NULL, 0);
+}
+
+void drv_write_pixels(const uint16_t *pixels, uint32_t count) {
+  uint8_t chunk[DRV_CHUNK * 2];
+  pixels_sent += count;
+  host_set_pin("DC", 1);
+  while (count > 0) {
+    uint32_t n = count < DRV_CHUNK ? count : DRV_CHUNK;
+    for (uint32_t i = 0; i < n; i++) {
+      chunk[i * 2] = pixels[i] >> 8;
+      chunk[i * 2 + 1] = pixels[i] & 0xff;
+    }
+    host_spi_send(chunk, n * 2);
+    pixels += n;
+    count -= n;
+  }
+}
+
+void drv_write_color(uint16_t color, uint32_t count) {
+  uint8_t chunk[DRV_CHUNK * 2];
+  uint32_t n = count < DRV_CHUNK ? count : DRV_CHUNK;
+  for (uint32_t i = 0; i < n; i++) {
+    chunk[i * 2] = color >> 8;
+    chunk[i * 2 + 1] = color & 0xff;
+  }
+  pixels_sent += count;
+  host_set_pin("DC", 1);
+  while (count > 0) {
+    n = count < DRV_CHUNK ? count : DRV_CHUNK;
+    host_spi_send(chunk, n * 2);
+    count -= n;
+  }
+}
+
+uint64_t drv_pixel_count(void) {
+  return pixels_sent;
+}
+
+void drv_command(uint8_t command, const uint8_t *args, uint32_t len) {
+  drv_start_write();
+  drv_write_command(command, args, len);
+  drv_end_write();
+}
+
+void drv_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
+  if (w == 0 || h == 0) {
+    return;
+  }
+  drv_start_write();
+  drv_set_window(x, y, x + w - 1, y + h - 1);
+  drv_write_color(color, (uint32_t)w * h);
+  drv_end_write();
+}
+
+void drv_draw_pixel(uint16_t x, uint16_t y, uint16_t color) {
+  drv_start_write();
+  drv_set_window(x, y, x, y);
+  drv_write_color(color, 1);
+  drv_end_write();
+}
+
+/*-----------------------------------------------------------
+   Reset pulse and the (register-relevant part of the) Adafruit
+   init sequence: sleep out, 16-bit color, MADCTL, display on.
+-----------------------------------------------------------*/
+void drv_begin(void) {
+  host_set_pin("CS", 1);
+  host_set_pin("RST", 1);
+  host_advance(1000000);
+  host_set_pin("RST", 0);
+  host_advance(10000);
+  host_set_pin("RST", 1);
+  host_advance(120000000);
+
+  drv_command(0x01, NULL, 0);          // SWRESET
+  host_advance(150000000);
+  drv_command(0x11, NULL, 0);          // SLPOUT
+  host_advance(120000000);
+  const uint8_t colmod = 0x55;
+  drv_command(0x3A, &colmod, 1);       // COLMOD: 16 bits/pixel
+  const uint8_t madctl = 0x48;
+  drv_command(0x36, &madctl, 1);       // MADCTL: BGR, mirrored X
+  drv_command(0x29, NULL, 0);          // DISPON
+  host_advance(20000000);
+}
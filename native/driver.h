@@ -0,0 +1,40 @@
+// Host-side GC9A01 driver for the native harness
+//
+// Sends the same SPI traffic as the Adafruit_GC9A01A library: commands
+// with DC low, parameters and pixels with DC high, framed by CS.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef GC9A01_DRIVER_H
+#define GC9A01_DRIVER_H
+
+#include <stdint.h>
+
+/* Hardware reset, then the init sequence up to DISPON. */
+void drv_begin(void);
+
+/* CS framing of a write transaction. */
+void drv_start_write(void);
+void drv_end_write(void);
+
+/* Inside a transaction: a command byte and its parameters, raw data. */
+void drv_write_command(uint8_t command, const uint8_t *args, uint32_t len);
+void drv_write_data(const uint8_t *data, uint32_t len);
+
+/* Inside a transaction: CASET + RASET + RAMWR for the inclusive window. */
+void drv_set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+/* Inside a transaction: count RGB565 pixels (native endian) sent big
+   endian, or count copies of one color. */
+void drv_write_pixels(const uint16_t *pixels, uint32_t count);
+void drv_write_color(uint16_t color, uint32_t count);
+
+/* Pixels sent by drv_write_pixels/drv_write_color so far. */
+uint64_t drv_pixel_count(void);
+
+/* Complete transactions, as the Adafruit GFX primitives send them. */
+void drv_command(uint8_t command, const uint8_t *args, uint32_t len);
+void drv_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+void drv_draw_pixel(uint16_t x, uint16_t y, uint16_t color);
+
+#endif /* GC9A01_DRIVER_H */
@@ -0,0 +1,441 @@
+// Framebuffer dumps for the native harness
+//
+// SPDX-License-Identifier: MIT
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include "host.h"
+#include "dump.h"
+
+#define DUMP_QUEUE_FRAMES  32       // Frames in flight before dump_present() waits
+#define DUMP_PNG_BLOCK     65535    // Largest stored deflate block
+
+typedef enum {
+  DUMP_JOB_IMAGE,
+  DUMP_JOB_VIDEO,
+} dump_job_kind_t;
+
+typedef struct {
+  dump_job_kind_t kind;
+  uint32_t *pixels;        // Copy of the framebuffer (owned by the job)
+  uint32_t width;
+  uint32_t height;
+  char *path;              // Image jobs
+  uint32_t repeat;         // Video jobs: frames this image lasts
+} dump_job_t;
+
+static struct {
+  bool running;
+  bool stopping;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  dump_job_t queue[DUMP_QUEUE_FRAMES];
+  uint32_t head;
+  uint32_t count;
+
+  char *pattern;
+  uint32_t frame;
+
+  /* Video: the last presented image waits in video_pending until the
+     next presentation tells how many frame ticks it lasted */
+  FILE *video;
+  bool video_header;       // Written by the writer thread
+  uint64_t video_period_ns;
+  uint64_t video_next_ns;
+  uint32_t *video_pending;
+} dump = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .changed = PTHREAD_COND_INITIALIZER,
+};
+
+/*-----------------------------------------------------------
+   Encoders (writer thread). Pixels are RGBA in memory order.
+-----------------------------------------------------------*/
+static bool write_ppm(FILE *f, const uint32_t *pixels, uint32_t width, uint32_t height) {
+  size_t count = (size_t)width * height;
+  uint8_t *rgb = malloc(count * 3);
+  if (!rgb) {
+    return false;
+  }
+  const uint8_t *p = (const uint8_t *)pixels;
+  for (size_t i = 0; i < count; i++) {
+    memcpy(&rgb[i * 3], &p[i * 4], 3);
+  }
+  fprintf(f, "P6\n%u %u\n255\n", width, height);
+  bool ok = fwrite(rgb, 1, count * 3, f) == count * 3;
+  free(rgb);
+  return ok;
+}
+
+static uint32_t png_crc_table[256];
+
+static uint32_t png_crc(uint32_t c, const uint8_t *data, size_t len) {
+  if (png_crc_table[1] == 0) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t t = n;
+      for (int k = 0; k < 8; k++) {
+        t = t & 1 ? 0xedb88320 ^ (t >> 1) : t >> 1;
+      }
+      png_crc_table[n] = t;
+    }
+  }
+  c ^= 0xffffffff;
+  for (size_t i = 0; i < len; i++) {
+    c = png_crc_table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+  }
+  return c ^ 0xffffffff;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static bool write_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t len) {
+  uint8_t header[8], trailer[4];
+  put_be32(header, len);
+  memcpy(header + 4, type, 4);
+  put_be32(trailer, png_crc(png_crc(0, header + 4, 4), data, len));
+  // IEND has no data; fwrite() must not be handed its NULL pointer.
+  return fwrite(header, 1, 8, f) == 8 && (len == 0 || fwrite(data, 1, len, f) == len) &&
+         fwrite(trailer, 1, 4, f) == 4;
+}
+
+/*-----------------------------------------------------------
+   PNG: 8-bit RGB, filter 0 on every row, and the zlib stream made
+   of stored (uncompressed) deflate blocks with an Adler-32 trailer.
+   Larger than a compressed PNG but trivial and fast to produce.
+-----------------------------------------------------------*/
+static bool write_png(FILE *f, const uint32_t *pixels, uint32_t width, uint32_t height) {
+  size_t raw_len = (size_t)height * (1 + (size_t)width * 3);
+  size_t blocks = (raw_len + DUMP_PNG_BLOCK - 1) / DUMP_PNG_BLOCK;
+  size_t idat_len = 2 + blocks * 5 + raw_len + 4;
+  uint8_t *raw = malloc(raw_len);
+  uint8_t *idat = malloc(idat_len);
+  if (!raw || !idat) {
+    free(raw);
+    free(idat);
+    return false;
+  }
+
+  const uint8_t *p = (const uint8_t *)pixels;
+  uint8_t *r = raw;
+  for (uint32_t y = 0; y < height; y++) {
+    *r++ = 0;
+    for (uint32_t x = 0; x < width; x++, p += 4) {
+      memcpy(r, p, 3);
+      r += 3;
+    }
+  }
+
+  uint32_t a = 1, b = 0;
+  for (size_t i = 0; i < raw_len; i++) {
+    a = (a + raw[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  uint8_t *out = idat;
+  *out++ = 0x78;
+  *out++ = 0x01;
+  for (size_t done = 0; done < raw_len;) {
+    uint32_t n = raw_len - done < DUMP_PNG_BLOCK ? raw_len - done : DUMP_PNG_BLOCK;
+    *out++ = done + n == raw_len;
+    *out++ = n & 0xff;
+    *out++ = n >> 8;
+    *out++ = ~n & 0xff;
+    *out++ = (~n >> 8) & 0xff;
+    memcpy(out, raw + done, n);
+    out += n;
+    done += n;
+  }
+  put_be32(out, (b << 16) | a);
+
+  static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  uint8_t ihdr[13] = { 0 };
+  put_be32(ihdr, width);
+  put_be32(ihdr + 4, height);
+  ihdr[8] = 8;   // Bit depth
+  ihdr[9] = 2;   // Truecolor
+  bool ok = fwrite(signature, 1, 8, f) == 8 &&
+            write_chunk(f, "IHDR", ihdr, sizeof(ihdr)) &&
+            write_chunk(f, "IDAT", idat, idat_len) &&
+            write_chunk(f, "IEND", NULL, 0);
+  free(raw);
+  free(idat);
+  return ok;
+}
+
+static void write_image(const dump_job_t *job) {
+  FILE *f = fopen(job->path, "wb");
+  if (!f) {
+    perror(job->path);
+    return;
+  }
+  size_t len = strlen(job->path);
+  bool png = len >= 4 && strcasecmp(job->path + len - 4, ".png") == 0;
+  bool ok = png ? write_png(f, job->pixels, job->width, job->height)
+                : write_ppm(f, job->pixels, job->width, job->height);
+  if (fclose(f) != 0 || !ok) {
+    fprintf(stderr, "dump: failed to write %s\n", job->path);
+  }
+}
+
+/*-----------------------------------------------------------
+   Y4M: 4:4:4 BT.601 (limited range) so that no chroma is lost at
+   the panel's 1-pixel details.
+-----------------------------------------------------------*/
+static void write_video(const dump_job_t *job) {
+  size_t count = (size_t)job->width * job->height;
+  uint8_t *planes = malloc(count * 3);
+  if (!planes) {
+    fprintf(stderr, "dump: failed to allocate a video frame\n");
+    return;
+  }
+  const uint8_t *p = (const uint8_t *)job->pixels;
+  for (size_t i = 0; i < count; i++, p += 4) {
+    int r = p[0], g = p[1], b = p[2];
+    planes[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+    planes[count + i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+    planes[2 * count + i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+  }
+  if (!dump.video_header) {
+    fprintf(dump.video, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n",
+            job->width, job->height, (uint32_t)(1000000000ull / dump.video_period_ns));
+    dump.video_header = true;
+  }
+  for (uint32_t i = 0; i < job->repeat; i++) {
+    fputs("FRAME\n", dump.video);
+    fwrite(planes, 1, count * 3, dump.video);
+  }
+  free(planes);
+}
+
+static void *writer(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&dump.lock);
+  for (;;) {
+    while (dump.count == 0 && !dump.stopping) {
+      pthread_cond_wait(&dump.changed, &dump.lock);
+    }
+    if (dump.count == 0) {
+      break;
+    }
+    dump_job_t job = dump.queue[dump.head];
+    pthread_mutex_unlock(&dump.lock);
+
+    if (job.kind == DUMP_JOB_IMAGE) {
+      write_image(&job);
+    } else {
+      write_video(&job);
+    }
+    free(job.pixels);
+    free(job.path);
+
+    pthread_mutex_lock(&dump.lock);
+    dump.head = (dump.head + 1) % DUMP_QUEUE_FRAMES;
+    dump.count--;
+    pthread_cond_broadcast(&dump.changed);
+  }
+  pthread_mutex_unlock(&dump.lock);
+  return NULL;
+}
+
+/*-----------------------------------------------------------
+   Producer side (the thread running the chip)
+-----------------------------------------------------------*/
+static bool start_writer(void) {
+  if (dump.running) {
+    return true;
+  }
+  if (pthread_create(&dump.thread, NULL, writer, NULL) != 0) {
+    fprintf(stderr, "dump: failed to start the writer thread\n");
+    return false;
+  }
+  dump.running = true;
+  return true;
+}
+
+static void push_job(dump_job_t job) {
+  pthread_mutex_lock(&dump.lock);
+  while (dump.count == DUMP_QUEUE_FRAMES) {
+    pthread_cond_wait(&dump.changed, &dump.lock);
+  }
+  dump.queue[(dump.head + dump.count) % DUMP_QUEUE_FRAMES] = job;
+  dump.count++;
+  pthread_cond_broadcast(&dump.changed);
+  pthread_mutex_unlock(&dump.lock);
+}
+
+static uint32_t *copy_framebuffer(uint32_t *width, uint32_t *height) {
+  const uint32_t *framebuffer = host_framebuffer(width, height);
+  if (!framebuffer) {
+    return NULL;
+  }
+  size_t size = (size_t)*width * *height * sizeof(uint32_t);
+  uint32_t *copy = malloc(size);
+  if (!copy) {
+    fprintf(stderr, "dump: failed to allocate a frame\n");
+    abort();
+  }
+  memcpy(copy, framebuffer, size);
+  return copy;
+}
+
+bool dump_image(const char *path) {
+  uint32_t width, height;
+  uint32_t *pixels = copy_framebuffer(&width, &height);
+  if (!pixels || !start_writer()) {
+    free(pixels);
+    return false;
+  }
+  char *name = strdup(path);
+  if (!name) {
+    fprintf(stderr, "dump: out of memory\n");
+    abort();
+  }
+  push_job((dump_job_t){
+    .kind = DUMP_JOB_IMAGE, .pixels = pixels, .width = width, .height = height, .path = name,
+  });
+  return true;
+}
+
+/*-----------------------------------------------------------
+   Expand a frame pattern into path. The pattern must hold exactly one
+   %u or %d, with an optional 0 flag and width, and %% for a literal
+   %; it is never used as a printf format. With path NULL the pattern
+   is only checked. False for any other pattern, or if the result does
+   not fit.
+-----------------------------------------------------------*/
+static bool expand_pattern(const char *pattern, uint32_t frame, char *path, size_t size) {
+  uint32_t conversions = 0;
+  size_t len = 0;
+  for (const char *p = pattern; *p; p++) {
+    char number[32];
+    const char *text = number;
+    if (*p != '%') {
+      number[0] = *p;
+      number[1] = '\0';
+    } else if (p[1] == '%') {
+      text = "%";
+      p++;
+    } else {
+      bool zero = p[1] == '0';
+      p += zero ? 2 : 1;
+      int width = 0;
+      while (*p >= '0' && *p <= '9' && width < 100) {
+        width = width * 10 + (*p++ - '0');
+      }
+      if ((*p != 'u' && *p != 'd') || width >= 20 || ++conversions > 1) {
+        return false;
+      }
+      snprintf(number, sizeof(number), zero ? "%0*u" : "%*u", width, frame);
+    }
+    size_t n = strlen(text);
+    if (path) {
+      if (len + n >= size) {
+        return false;
+      }
+      memcpy(path + len, text, n + 1);
+    }
+    len += n;
+  }
+  return conversions == 1;
+}
+
+bool dump_frames(const char *pattern) {
+  if (!expand_pattern(pattern, 0, NULL, 0)) {
+    fprintf(stderr, "dump: %s: a frame pattern needs exactly one %%u or %%d (e.g. frame-%%05u.png), "
+            "and %%%% for a literal %%\n", pattern);
+    return false;
+  }
+  free(dump.pattern);
+  dump.pattern = strdup(pattern);
+  return dump.pattern && start_writer();
+}
+
+bool dump_video(const char *path, uint32_t fps) {
+  if (dump.video || fps == 0) {
+    return false;
+  }
+  dump.video = fopen(path, "wb");
+  if (!dump.video) {
+    perror(path);
+    return false;
+  }
+  dump.video_period_ns = 1000000000ull / fps;
+  return start_writer();
+}
+
+// Queue the pending video image for the frame ticks before now.
+static void flush_video(uint64_t now, bool last) {
+  uint32_t repeat = 0;
+  while (dump.video_next_ns < now) {
+    dump.video_next_ns += dump.video_period_ns;
+    repeat++;
+  }
+  if (repeat == 0 && !last) {
+    return;
+  }
+  uint32_t width, height;
+  host_framebuffer(&width, &height);
+  push_job((dump_job_t){
+    .kind = DUMP_JOB_VIDEO, .pixels = dump.video_pending, .width = width, .height = height,
+    .repeat = repeat ? repeat : 1,
+  });
+  dump.video_pending = NULL;
+}
+
+void dump_present(void) {
+  if (dump.pattern) {
+    char path[4096];
+    if (expand_pattern(dump.pattern, dump.frame, path, sizeof(path))) {
+      dump_image(path);
+    } else {
+      fprintf(stderr, "dump: %s: path too long for frame %u\n", dump.pattern, dump.frame);
+    }
+  }
+  dump.frame++;
+
+  if (dump.video) {
+    uint64_t now = host_now();
+    if (!dump.video_pending) {
+      // The first presentation starts the video.
+      dump.video_next_ns = now;
+    } else {
+      flush_video(now, false);
+    }
+    uint32_t width, height;
+    free(dump.video_pending);
+    dump.video_pending = copy_framebuffer(&width, &height);
+  }
+}
+
+void dump_close(void) {
+  if (dump.video && dump.video_pending) {
+    flush_video(host_now() + 1, true);
+  }
+  if (dump.running) {
+    pthread_mutex_lock(&dump.lock);
+    dump.stopping = true;
+    pthread_cond_broadcast(&dump.changed);
+    pthread_mutex_unlock(&dump.lock);
+    pthread_join(dump.thread, NULL);
+    dump.running = false;
+    dump.stopping = false;
+  }
+  if (dump.video) {
+    if (fclose(dump.video) != 0) {
+      fprintf(stderr, "dump: failed to write the video\n");
+    }
+    dump.video = NULL;
+    dump.video_header = false;
+  }
+  free(dump.pattern);
+  dump.pattern = NULL;
+}
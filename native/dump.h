@@ -0,0 +1,42 @@
+// Framebuffer dumps for the native harness
+//
+// Writes the presented framebuffer as PPM or PNG images (the format
+// follows the file extension; PNG uses a small built-in encoder with
+// stored deflate blocks, so there is no zlib dependency) and streams
+// whole sessions into one Y4M video.
+//
+// dump_present() only copies the framebuffer and queues it; a writer
+// thread converts and writes, so dumping barely moves benchmark and
+// replay timings. The queue is bounded: if the disk cannot keep up the
+// caller waits rather than buffering without limit.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef GC9A01_NATIVE_DUMP_H
+#define GC9A01_NATIVE_DUMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DUMP_VIDEO_FPS  60
+
+/* Dump every presented frame to pattern, a path with one %u or %d for
+   the frame number (0 flag and width allowed, %% for a literal %), e.g.
+   "frame-%05u.png". False for any other pattern. Call before
+   chip_init() or later. */
+bool dump_frames(const char *pattern);
+
+/* Stream the presented framebuffer into a Y4M video at fps frames per
+   second of simulated time (frames are repeated between presentations). */
+bool dump_video(const char *path, uint32_t fps);
+
+/* Queue the current framebuffer for path now (on demand). */
+bool dump_image(const char *path);
+
+/* Presentation hook (host_observer_t.present). */
+void dump_present(void);
+
+/* Write what is queued, finish the video and stop the writer. */
+void dump_close(void);
+
+#endif /* GC9A01_NATIVE_DUMP_H */
@@ -0,0 +1,932 @@
+// Native host for the GC9A01 chip: wokwi-api.h imports
+//
+// A single simulated device: pins, attributes, one SPI device, timers,
+// one UART and the framebuffer, all kept in the host structure below.
+// See host.h for the harness side.
+//
+// Everything that happens at a point in simulated time (timer expiries,
+// scheduled pin edges and SPI chunks) is an event in one priority queue
+// ordered by (time, sequence number), so runs are deterministic and as
+// fast as the CPU allows.
+//
+// SPDX-License-Identifier: MIT
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "host.h"
+
+// wokwi-api.h's timer_t would clash with the POSIX one.
+#define timer_t wokwi_timer_t
+#include "wokwi-api.h"
+#undef timer_t
+
+#define HOST_MAX_PINS    32
+#define HOST_MAX_ATTRS   32
+#define HOST_MAX_TIMERS  16
+
+#define HOST_SETTLE_STEP_NS  1000000ull      // host_settle() runs the chip in steps of this
+#define HOST_QUIET_NS        300000000ull    // No framebuffer write for this long: nothing pending
+#define HOST_SETTLE_MAX_NS   10000000000ull  // Give up settling after this
+
+/* Profile contexts: what the chip was doing when it called an import */
+#define HOST_CONTEXT_HARNESS  0   // chip_init() and anything outside a callback
+#define HOST_CONTEXT_PIN      1   // pin_change
+#define HOST_CONTEXT_SPI      2   // SPI done
+#define HOST_CONTEXT_TIMER    3   // Timer callbacks, one context per timer
+#define HOST_CONTEXTS         (HOST_CONTEXT_TIMER + HOST_MAX_TIMERS)
+
+typedef struct {
+  const char *name;
+  uint32_t value;
+  bool watched;
+  pin_watch_config_t watch;
+} host_pin_t;
+
+typedef struct {
+  const char *name;
+  uint32_t value;
+} host_attr_t;
+
+typedef struct {
+  timer_config_t config;
+  bool active;
+  bool repeat;
+  uint64_t period_ns;
+  uint32_t generation;     // Bumped on start/stop; older queued expiries are stale
+} host_timer_t;
+
+typedef enum {
+  HOST_IMPORT_BUFFER_WRITE,
+  HOST_IMPORT_BUFFER_READ,
+  HOST_IMPORT_SPI_START,
+  HOST_IMPORT_SPI_STOP,
+  HOST_IMPORT_PIN_READ,
+  HOST_IMPORT_PIN_WRITE,
+  HOST_IMPORT_ATTR_READ,
+  HOST_IMPORT_TIMER_START,
+  HOST_IMPORT_TIMER_STOP,
+  HOST_IMPORT_UART_WRITE,
+  HOST_IMPORT_GET_SIM_NANOS,
+  HOST_IMPORT_COUNT
+} host_import_t;
+
+static const char *const import_names[HOST_IMPORT_COUNT] = {
+  "buffer_write", "buffer_read", "spi_start", "spi_stop", "pin_read", "pin_write",
+  "attr_read", "timer_start", "timer_stop", "uart_write", "get_sim_nanos",
+};
+
+/* Calls and bytes (copied, or armed by spi_start) per import and
+   context; a frame is a callback that wrote the framebuffer */
+typedef struct {
+  uint64_t calls[HOST_IMPORT_COUNT][HOST_CONTEXTS];
+  uint64_t bytes[HOST_IMPORT_COUNT][HOST_CONTEXTS];
+  uint64_t callbacks[HOST_CONTEXTS];
+  uint32_t context;
+  bool wrote;              // The current callback wrote the framebuffer
+} host_profile_t;
+
+typedef struct {
+  uint32_t context;
+  bool wrote;
+} host_scope_t;
+
+typedef enum {
+  HOST_EVENT_TIMER,
+  HOST_EVENT_PIN,
+  HOST_EVENT_SPI,
+} host_event_kind_t;
+
+typedef struct {
+  uint64_t at_ns;
+  uint64_t seq;            // Insertion order among events at the same time
+  host_event_kind_t kind;
+  uint32_t index;          // Timer or pin index
+  uint32_t value;          // Timer generation or pin value
+  uint8_t *data;           // SPI chunk (owned by the event)
+  uint32_t len;
+} host_event_t;
+
+static struct {
+  uint64_t now_ns;
+
+  host_pin_t pins[HOST_MAX_PINS];
+  uint32_t pin_count;
+
+  host_attr_t attrs[HOST_MAX_ATTRS];
+  uint32_t attr_count;
+
+  /* SPI device: the chip arms a buffer with spi_start() and gets it
+     back through the done callback once full or on spi_stop() */
+  spi_config_t spi;
+  uint8_t *spi_buffer;
+  uint32_t spi_size;
+  uint32_t spi_fill;
+  bool spi_armed;
+  uint64_t spi_byte_ns;
+
+  /* The bus carries one transfer at a time: chunks sent while one is
+     clocking in (from events run during its bus time) wait here */
+  bool spi_busy;
+  host_event_t *spi_backlog;
+  uint32_t spi_backlog_count;
+  uint32_t spi_backlog_capacity;
+
+  host_timer_t timers[HOST_MAX_TIMERS];
+  uint32_t timer_count;
+
+  /* Event queue: binary min-heap on (at_ns, seq) */
+  host_event_t *events;
+  uint32_t event_count;
+  uint32_t event_capacity;
+  uint64_t event_seq;
+
+  /* UART: one write in flight, completed by the uart_timer */
+  uart_config_t uart;
+  bool uart_busy;
+  uint32_t uart_timer;
+  FILE *uart_output;
+
+  uint32_t *framebuffer;
+  uint32_t width;
+  uint32_t height;
+
+  host_observer_t observer;
+  host_stats_t stats;
+  host_profile_t profile;
+} host = {
+  .spi_byte_ns = 8 * 1000000000ull / HOST_DEFAULT_SPI_CLOCK,
+};
+
+/*-----------------------------------------------------------
+   Boundary profile: in the simulator every import call crosses
+   the wasm boundary, which costs far more than the work most of
+   them do. Each call is counted, with its bytes, against the
+   callback the chip is in; callbacks nest (spi_stop() in a
+   pin_change calls the SPI done callback).
+-----------------------------------------------------------*/
+static void count_import(host_import_t import, uint32_t bytes) {
+  host.profile.calls[import][host.profile.context]++;
+  host.profile.bytes[import][host.profile.context] += bytes;
+  host.stats.import_calls++;
+}
+
+static host_scope_t enter_callback(uint32_t context) {
+  host_scope_t outer = { host.profile.context, host.profile.wrote };
+  host.profile.context = context;
+  host.profile.wrote = false;
+  host.profile.callbacks[context]++;
+  return outer;
+}
+
+static void leave_callback(host_scope_t outer) {
+  if (host.profile.wrote) {
+    host.stats.frames++;
+    if (host.observer.present) {
+      host.observer.present();
+    }
+  }
+  host.profile.context = outer.context;
+  host.profile.wrote = outer.wrote;
+}
+
+/*-----------------------------------------------------------
+   Pins
+-----------------------------------------------------------*/
+static host_pin_t *find_pin(const char *name) {
+  for (uint32_t i = 0; i < host.pin_count; i++) {
+    if (strcmp(host.pins[i].name, name) == 0) {
+      return &host.pins[i];
+    }
+  }
+  return NULL;
+}
+
+static host_pin_t *add_pin(const char *name, uint32_t value) {
+  if (host.pin_count == HOST_MAX_PINS) {
+    fprintf(stderr, "host: too many pins\n");
+    abort();
+  }
+  host_pin_t *pin = &host.pins[host.pin_count++];
+  pin->name = name;
+  pin->value = value;
+  return pin;
+}
+
+pin_t pin_init(const char *name, uint32_t mode) {
+  host_pin_t *pin = find_pin(name);
+  if (!pin) {
+    pin = add_pin(name, mode == INPUT_PULLUP || mode == OUTPUT_HIGH);
+  } else if (mode == OUTPUT_LOW || mode == OUTPUT_HIGH) {
+    pin->value = mode == OUTPUT_HIGH;
+  }
+  return pin - host.pins;
+}
+
+uint32_t pin_read(pin_t pin) {
+  count_import(HOST_IMPORT_PIN_READ, 0);
+  return pin >= 0 && (uint32_t)pin < host.pin_count ? host.pins[pin].value : LOW;
+}
+
+void pin_write(pin_t pin, uint32_t value) {
+  count_import(HOST_IMPORT_PIN_WRITE, 0);
+  if (pin >= 0 && (uint32_t)pin < host.pin_count) {
+    host.pins[pin].value = value;
+  }
+}
+
+bool pin_watch(pin_t pin, const pin_watch_config_t *config) {
+  if (pin < 0 || (uint32_t)pin >= host.pin_count) {
+    return false;
+  }
+  host.pins[pin].watch = *config;
+  host.pins[pin].watched = true;
+  return true;
+}
+
+void pin_watch_stop(pin_t pin) {
+  if (pin >= 0 && (uint32_t)pin < host.pin_count) {
+    host.pins[pin].watched = false;
+  }
+}
+
+void pin_mode(pin_t pin, uint32_t value) {
+  if (value == OUTPUT_LOW || value == OUTPUT_HIGH) {
+    pin_write(pin, value == OUTPUT_HIGH);
+  }
+}
+
+void host_set_pin(const char *name, uint32_t value) {
+  host_pin_t *pin = find_pin(name);
+  if (!pin) {
+    pin = add_pin(name, !value);
+  }
+  value = value ? HIGH : LOW;
+  if (pin->value == value) {
+    return;
+  }
+  pin->value = value;
+  if (pin->watched && (pin->watch.edge & (value ? RISING : FALLING))) {
+    host_scope_t outer = enter_callback(HOST_CONTEXT_PIN);
+    pin->watch.pin_change(pin->watch.user_data, pin - host.pins, value);
+    leave_callback(outer);
+  }
+  // After the chip flushed the bytes received before the edge.
+  if (host.observer.pin) {
+    host.observer.pin(pin->name, value);
+  }
+}
+
+uint32_t host_get_pin(const char *name) {
+  host_pin_t *pin = find_pin(name);
+  return pin ? pin->value : LOW;
+}
+
+/*-----------------------------------------------------------
+   Attributes
+-----------------------------------------------------------*/
+static host_attr_t *find_attr(const char *name) {
+  for (uint32_t i = 0; i < host.attr_count; i++) {
+    if (strcmp(host.attrs[i].name, name) == 0) {
+      return &host.attrs[i];
+    }
+  }
+  return NULL;
+}
+
+static host_attr_t *add_attr(const char *name, uint32_t value) {
+  if (host.attr_count == HOST_MAX_ATTRS) {
+    fprintf(stderr, "host: too many attributes\n");
+    abort();
+  }
+  host_attr_t *attr = &host.attrs[host.attr_count++];
+  attr->name = name;
+  attr->value = value;
+  return attr;
+}
+
+uint32_t attr_init(const char *name, uint32_t default_value) {
+  host_attr_t *attr = find_attr(name);
+  if (!attr) {
+    attr = add_attr(name, default_value);
+  }
+  return attr - host.attrs;
+}
+
+uint32_t attr_read(uint32_t attr_id) {
+  count_import(HOST_IMPORT_ATTR_READ, 0);
+  return attr_id < host.attr_count ? host.attrs[attr_id].value : 0;
+}
+
+void host_set_attr(const char *name, uint32_t value) {
+  host_attr_t *attr = find_attr(name);
+  if (attr) {
+    attr->value = value;
+  } else {
+    add_attr(name, value);
+  }
+}
+
+void host_present_whole_frames(void) {
+  host_set_attr("slice_pixels", 0);
+}
+
+/*-----------------------------------------------------------
+   Tool command lines: -a name=value attributes, kept outside the
+   host structure so they survive host_reset().
+-----------------------------------------------------------*/
+static struct {
+  const char *names[HOST_MAX_ATTRS];
+  uint32_t values[HOST_MAX_ATTRS];
+  uint32_t count;
+} arg_attrs;
+
+bool host_parse_attr(char *arg) {
+  char *value = strchr(arg, '=');
+  if (!value || arg_attrs.count == HOST_MAX_ATTRS) {
+    return false;
+  }
+  *value++ = '\0';
+  arg_attrs.names[arg_attrs.count] = arg;
+  arg_attrs.values[arg_attrs.count++] = strtoul(value, NULL, 0);
+  return true;
+}
+
+void host_apply_attrs(void) {
+  for (uint32_t i = 0; i < arg_attrs.count; i++) {
+    host_set_attr(arg_attrs.names[i], arg_attrs.values[i]);
+  }
+}
+
+double host_cpu_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*-----------------------------------------------------------
+   Event queue
+-----------------------------------------------------------*/
+static bool event_before(const host_event_t *a, const host_event_t *b) {
+  return a->at_ns < b->at_ns || (a->at_ns == b->at_ns && a->seq < b->seq);
+}
+
+static void push_event(host_event_t event) {
+  if (host.event_count == host.event_capacity) {
+    host.event_capacity = host.event_capacity ? host.event_capacity * 2 : 64;
+    host.events = realloc(host.events, host.event_capacity * sizeof(host_event_t));
+    if (!host.events) {
+      fprintf(stderr, "host: failed to allocate the event queue\n");
+      abort();
+    }
+  }
+  event.seq = host.event_seq++;
+  uint32_t i = host.event_count++;
+  while (i > 0) {
+    uint32_t parent = (i - 1) / 2;
+    if (!event_before(&event, &host.events[parent])) {
+      break;
+    }
+    host.events[i] = host.events[parent];
+    i = parent;
+  }
+  host.events[i] = event;
+}
+
+static host_event_t pop_event(void) {
+  host_event_t top = host.events[0];
+  host_event_t last = host.events[--host.event_count];
+  uint32_t i = 0;
+  for (;;) {
+    uint32_t child = i * 2 + 1;
+    if (child >= host.event_count) {
+      break;
+    }
+    if (child + 1 < host.event_count && event_before(&host.events[child + 1], &host.events[child])) {
+      child++;
+    }
+    if (!event_before(&host.events[child], &last)) {
+      break;
+    }
+    host.events[i] = host.events[child];
+    i = child;
+  }
+  if (host.event_count > 0) {
+    host.events[i] = last;
+  }
+  return top;
+}
+
+/*-----------------------------------------------------------
+   Timers: each start queues an expiry tagged with the timer's
+   generation, so restarting or stopping a timer just makes the
+   queued expiry stale.
+-----------------------------------------------------------*/
+static uint32_t add_timer(const timer_config_t *config) {
+  if (host.timer_count == HOST_MAX_TIMERS) {
+    fprintf(stderr, "host: too many timers\n");
+    abort();
+  }
+  host.timers[host.timer_count].config = *config;
+  return host.timer_count++;
+}
+
+static void start_timer(uint32_t timer, uint64_t ns, bool repeat) {
+  if (timer >= host.timer_count) {
+    return;
+  }
+  host_timer_t *t = &host.timers[timer];
+  t->active = true;
+  t->repeat = repeat && ns > 0;
+  t->period_ns = ns;
+  t->generation++;
+  push_event((host_event_t){
+    .at_ns = host.now_ns + ns, .kind = HOST_EVENT_TIMER, .index = timer, .value = t->generation,
+  });
+}
+
+uint32_t timer_init(const timer_config_t *config) {
+  return add_timer(config);
+}
+
+void timer_start(const uint32_t timer, uint32_t micros, bool repeat) {
+  count_import(HOST_IMPORT_TIMER_START, 0);
+  start_timer(timer, (uint64_t)micros * 1000, repeat);
+}
+
+void timer_start_ns_d(const uint32_t timer, double nanos, bool repeat) {
+  count_import(HOST_IMPORT_TIMER_START, 0);
+  start_timer(timer, (uint64_t)nanos, repeat);
+}
+
+void timer_stop(const uint32_t timer) {
+  count_import(HOST_IMPORT_TIMER_STOP, 0);
+  if (timer < host.timer_count) {
+    host.timers[timer].active = false;
+    host.timers[timer].generation++;
+  }
+}
+
+double get_sim_nanos_d(void) {
+  count_import(HOST_IMPORT_GET_SIM_NANOS, 0);
+  return (double)host.now_ns;
+}
+
+static void fire_timer(const host_event_t *event) {
+  host_timer_t *t = &host.timers[event->index];
+  if (!t->active || t->generation != event->value) {
+    return;
+  }
+  if (t->repeat) {
+    push_event((host_event_t){
+      .at_ns = event->at_ns + t->period_ns, .kind = HOST_EVENT_TIMER,
+      .index = event->index, .value = t->generation,
+    });
+  } else {
+    t->active = false;
+  }
+  host.stats.timer_callbacks++;
+  host_scope_t outer = enter_callback(HOST_CONTEXT_TIMER + event->index);
+  t->config.callback(t->config.user_data);
+  leave_callback(outer);
+}
+
+/*-----------------------------------------------------------
+   Queue a chunk (owned) behind the transfer on the bus.
+-----------------------------------------------------------*/
+static void queue_spi(uint8_t *data, uint32_t len) {
+  if (host.spi_backlog_count == host.spi_backlog_capacity) {
+    host.spi_backlog_capacity = host.spi_backlog_capacity ? host.spi_backlog_capacity * 2 : 8;
+    host.spi_backlog = realloc(host.spi_backlog, host.spi_backlog_capacity * sizeof(host_event_t));
+    if (!host.spi_backlog) {
+      fprintf(stderr, "host: failed to allocate the SPI backlog\n");
+      abort();
+    }
+  }
+  host.spi_backlog[host.spi_backlog_count++] = (host_event_t){ .data = data, .len = len };
+}
+
+/*-----------------------------------------------------------
+   Run events in (time, sequence) order up to ns. Handlers may queue
+   new events or run the clock themselves (an SPI chunk takes bus
+   time), which just processes the next events from the inside.
+-----------------------------------------------------------*/
+void host_run_until(uint64_t ns) {
+  while (host.event_count > 0 && host.events[0].at_ns <= ns) {
+    host_event_t event = pop_event();
+    if (event.at_ns > host.now_ns) {
+      host.now_ns = event.at_ns;
+    }
+    host.stats.events++;
+    switch (event.kind) {
+      case HOST_EVENT_TIMER:
+        fire_timer(&event);
+        break;
+      case HOST_EVENT_PIN:
+        host_set_pin(host.pins[event.index].name, event.value);
+        break;
+      case HOST_EVENT_SPI:
+        if (host.spi_busy) {
+          queue_spi(event.data, event.len);
+        } else {
+          host_spi_send(event.data, event.len);
+          free(event.data);
+        }
+        break;
+    }
+  }
+  if (ns > host.now_ns) {
+    host.now_ns = ns;
+  }
+}
+
+void host_advance(uint64_t ns) {
+  host_run_until(host.now_ns + ns);
+}
+
+/*-----------------------------------------------------------
+   A presentation can be spread over many slice callbacks, so the
+   chip runs until nothing has been written for HOST_QUIET_NS: longer
+   than a refresh period plus a presentation that finds one row per
+   slice unchanged, so no presentation is pending and no dirty rows
+   remain.
+-----------------------------------------------------------*/
+void host_settle(bool (*done)(void)) {
+  uint64_t start = host.now_ns;
+  uint64_t quiet_since = start;
+  uint64_t writes = host.stats.buffer_writes;
+  while (!(done && done())) {
+    if (host.now_ns - quiet_since >= HOST_QUIET_NS || host.now_ns - start >= HOST_SETTLE_MAX_NS) {
+      break;
+    }
+    host_advance(HOST_SETTLE_STEP_NS);
+    if (host.stats.buffer_writes != writes) {
+      writes = host.stats.buffer_writes;
+      quiet_since = host.now_ns;
+    }
+  }
+}
+
+void host_schedule_pin(uint64_t at_ns, const char *name, uint32_t value) {
+  host_pin_t *pin = find_pin(name);
+  if (!pin) {
+    pin = add_pin(name, !value);
+  }
+  push_event((host_event_t){
+    .at_ns = at_ns, .kind = HOST_EVENT_PIN, .index = pin - host.pins, .value = value ? HIGH : LOW,
+  });
+}
+
+void host_schedule_spi(uint64_t at_ns, const uint8_t *data, uint32_t count) {
+  uint8_t *copy = malloc(count ? count : 1);
+  if (!copy) {
+    fprintf(stderr, "host: failed to allocate an SPI event\n");
+    abort();
+  }
+  memcpy(copy, data, count);
+  push_event((host_event_t){
+    .at_ns = at_ns, .kind = HOST_EVENT_SPI, .data = copy, .len = count,
+  });
+}
+
+uint64_t host_now(void) {
+  return host.now_ns;
+}
+
+/*-----------------------------------------------------------
+   SPI
+-----------------------------------------------------------*/
+uint32_t spi_init(const spi_config_t *spi_config) {
+  host.spi = *spi_config;
+  return 0;
+}
+
+void spi_start(const uint32_t spi, uint8_t *buffer, uint32_t count) {
+  (void)spi;
+  count_import(HOST_IMPORT_SPI_START, count);
+  host.spi_buffer = buffer;
+  host.spi_size = count;
+  host.spi_fill = 0;
+  host.spi_armed = count > 0;
+}
+
+static void spi_complete(void) {
+  host.spi_armed = false;
+  host.stats.spi_chunks++;
+  host.stats.spi_bytes += host.spi_fill;
+  if (host.observer.spi && host.spi_fill > 0) {
+    host.observer.spi(host.spi_buffer, host.spi_fill);
+  }
+  host_scope_t outer = enter_callback(HOST_CONTEXT_SPI);
+  host.spi.done(host.spi.user_data, host.spi_buffer, host.spi_fill);
+  leave_callback(outer);
+}
+
+void spi_stop(const uint32_t spi) {
+  (void)spi;
+  count_import(HOST_IMPORT_SPI_STOP, 0);
+  if (host.spi_armed) {
+    spi_complete();
+  }
+}
+
+void host_set_spi_clock(uint32_t hz) {
+  host.spi_byte_ns = hz ? 8 * 1000000000ull / hz : 0;
+}
+
+/*-----------------------------------------------------------
+   Clock bytes into the chip. Each run of bytes that fits the armed
+   buffer takes its bus time first (events due meanwhile run before
+   the bytes arrive, as in the simulator), then lands in the buffer;
+   events due at the moment the transfer completes run after that.
+   Chunks sent by events during that bus time queue behind the
+   transfer instead of overtaking it.
+-----------------------------------------------------------*/
+static void clock_in(const uint8_t *data, uint32_t count) {
+  while (count > 0) {
+    uint32_t n = count;
+    if (host.spi_armed && n > host.spi_size - host.spi_fill) {
+      n = host.spi_size - host.spi_fill;
+    }
+    uint64_t end = host.now_ns + n * host.spi_byte_ns;
+    if (end > host.now_ns) {
+      host_run_until(end - 1);
+      host.now_ns = end;
+    }
+
+    uint32_t taken = 0;
+    if (host.spi_armed) {
+      taken = host.spi_size - host.spi_fill < n ? host.spi_size - host.spi_fill : n;
+      memcpy(host.spi_buffer + host.spi_fill, data, taken);
+      host.spi_fill += taken;
+      if (host.spi_fill == host.spi_size) {
+        spi_complete();
+      }
+    }
+    host.stats.spi_dropped += n - taken;
+    data += n;
+    count -= n;
+    host_run_until(end);
+  }
+}
+
+void host_spi_send(const uint8_t *data, uint32_t count) {
+  if (host.spi_busy) {
+    uint8_t *copy = malloc(count ? count : 1);
+    if (!copy) {
+      fprintf(stderr, "host: failed to allocate an SPI chunk\n");
+      abort();
+    }
+    memcpy(copy, data, count);
+    queue_spi(copy, count);
+    return;
+  }
+  host.spi_busy = true;
+  clock_in(data, count);
+  // The backlog can grow while it drains.
+  for (uint32_t i = 0; i < host.spi_backlog_count; i++) {
+    clock_in(host.spi_backlog[i].data, host.spi_backlog[i].len);
+    free(host.spi_backlog[i].data);
+  }
+  host.spi_backlog_count = 0;
+  host.spi_busy = false;
+}
+
+/*-----------------------------------------------------------
+   Hand bytes to the chip as one SPI chunk right now (no bus time),
+   the way a replayed trace reproduces the original chunk boundaries.
+   Returns how many bytes fit the armed buffer (0 if the chip is not
+   listening); the caller decides what to do with the rest. A chunk
+   the chip ended with spi_stop() at a pin edge is held open, so that
+   the replayed edge's spi_stop() completes it in one callback as it
+   did when recorded, instead of adding an empty one.
+-----------------------------------------------------------*/
+uint32_t host_spi_deliver(const uint8_t *data, uint32_t count, bool hold) {
+  uint32_t taken = 0;
+  if (host.spi_armed && count > 0) {
+    taken = host.spi_size - host.spi_fill < count ? host.spi_size - host.spi_fill : count;
+    memcpy(host.spi_buffer + host.spi_fill, data, taken);
+    host.spi_fill += taken;
+    if (!hold || host.spi_fill == host.spi_size) {
+      spi_complete();
+    }
+  }
+  return taken;
+}
+
+void host_spi_release(void) {
+  if (host.spi_armed && host.spi_fill > 0) {
+    spi_complete();
+  }
+}
+
+/*-----------------------------------------------------------
+   UART (transmit only): a write completes after its bytes' time on
+   the wire at 10 bits per byte.
+-----------------------------------------------------------*/
+static void uart_write_done(void *user_data) {
+  (void)user_data;
+  host.uart_busy = false;
+  if (host.uart.write_done) {
+    host.uart.write_done(host.uart.user_data);
+  }
+}
+
+uint32_t uart_init(const uart_config_t *config) {
+  host.uart = *config;
+  const timer_config_t timer_config = {
+    .callback = uart_write_done,
+  };
+  host.uart_timer = add_timer(&timer_config);
+  return 0;
+}
+
+bool uart_write(uint32_t uart, uint8_t *buffer, uint32_t count) {
+  (void)uart;
+  count_import(HOST_IMPORT_UART_WRITE, count);
+  if (host.uart_busy || host.uart.baud_rate == 0) {
+    return false;
+  }
+  if (host.uart_output) {
+    fwrite(buffer, 1, count, host.uart_output);
+  }
+  host.uart_busy = true;
+  start_timer(host.uart_timer, (uint64_t)count * 10 * 1000000000ull / host.uart.baud_rate, false);
+  return true;
+}
+
+void host_set_uart_output(FILE *output) {
+  host.uart_output = output;
+}
+
+/*-----------------------------------------------------------
+   Framebuffer
+-----------------------------------------------------------*/
+uint32_t framebuffer_init(uint32_t *pixel_width, uint32_t *pixel_height) {
+  host.width = *pixel_width;
+  host.height = *pixel_height;
+  host.framebuffer = calloc((size_t)host.width * host.height, sizeof(uint32_t));
+  if (!host.framebuffer) {
+    fprintf(stderr, "host: failed to allocate the framebuffer\n");
+    abort();
+  }
+  return 0;
+}
+
+static void check_buffer(uint32_t offset, uint32_t data_len) {
+  uint64_t size = (uint64_t)host.width * host.height * 4;
+  if (!host.framebuffer || (uint64_t)offset + data_len > size) {
+    fprintf(stderr, "host: buffer access %u+%u outside the %llu byte framebuffer\n",
+            offset, data_len, (unsigned long long)size);
+    abort();
+  }
+}
+
+void buffer_write(uint32_t buffer, uint32_t offset, void *data, uint32_t data_len) {
+  (void)buffer;
+  check_buffer(offset, data_len);
+  count_import(HOST_IMPORT_BUFFER_WRITE, data_len);
+  host.profile.wrote = true;
+  memcpy((uint8_t *)host.framebuffer + offset, data, data_len);
+  host.stats.buffer_writes++;
+  host.stats.buffer_bytes += data_len;
+}
+
+void buffer_read(uint32_t buffer, uint32_t offset, void *data, uint32_t data_len) {
+  (void)buffer;
+  check_buffer(offset, data_len);
+  count_import(HOST_IMPORT_BUFFER_READ, data_len);
+  memcpy(data, (uint8_t *)host.framebuffer + offset, data_len);
+}
+
+const uint32_t *host_framebuffer(uint32_t *width, uint32_t *height) {
+  *width = host.width;
+  *height = host.height;
+  return host.framebuffer;
+}
+
+/*-----------------------------------------------------------
+   CRC32 (zlib) of the framebuffer bytes, for comparing runs.
+-----------------------------------------------------------*/
+uint32_t host_crc32(uint32_t crc, const void *data, size_t len) {
+  static uint32_t table[256];
+  if (table[1] == 0) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) {
+        c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+  }
+  const uint8_t *p = data;
+  uint32_t c = crc ^ 0xffffffff;
+  for (size_t i = 0; i < len; i++) {
+    c = table[(c ^ p[i]) & 0xff] ^ (c >> 8);
+  }
+  return c ^ 0xffffffff;
+}
+
+uint32_t host_framebuffer_crc(void) {
+  size_t len = host.framebuffer ? (size_t)host.width * host.height * 4 : 0;
+  return host_crc32(0, host.framebuffer, len);
+}
+
+void host_set_observer(const host_observer_t *observer) {
+  host.observer = *observer;
+}
+
+/*-----------------------------------------------------------
+   Boundary profile table: per import over the whole run and per
+   presented frame, then per callback.
+-----------------------------------------------------------*/
+static const char *context_name(uint32_t context, char *name, size_t size) {
+  if (context == HOST_CONTEXT_HARNESS) {
+    return "harness";
+  } else if (context == HOST_CONTEXT_PIN) {
+    return "pin_change";
+  } else if (context == HOST_CONTEXT_SPI) {
+    return "spi done";
+  } else if (host.uart.baud_rate && context == HOST_CONTEXT_TIMER + host.uart_timer) {
+    return "uart write_done";
+  }
+  snprintf(name, size, "timer %u", context - HOST_CONTEXT_TIMER);
+  return name;
+}
+
+void host_print_profile(FILE *out) {
+  const host_profile_t *p = &host.profile;
+  uint64_t frames = host.stats.frames ? host.stats.frames : 1;
+  fprintf(out, "host imports: %llu frames presented (callbacks that wrote the framebuffer)\n",
+          (unsigned long long)host.stats.frames);
+  fprintf(out, "%-15s %12s %14s %12s %12s\n", "import", "calls", "bytes", "calls/frame", "bytes/frame");
+  for (uint32_t i = 0; i < HOST_IMPORT_COUNT; i++) {
+    uint64_t calls = 0, bytes = 0;
+    for (uint32_t c = 0; c < HOST_CONTEXTS; c++) {
+      calls += p->calls[i][c];
+      bytes += p->bytes[i][c];
+    }
+    if (calls > 0) {
+      fprintf(out, "%-15s %12llu %14llu %12.1f %12.0f\n", import_names[i],
+              (unsigned long long)calls, (unsigned long long)bytes,
+              (double)calls / frames, (double)bytes / frames);
+    }
+  }
+
+  // The imports that matter most, per callback call; the harness row
+  // (chip_init() and calls outside any callback) shows totals.
+  static const host_import_t columns[] = {
+    HOST_IMPORT_BUFFER_WRITE, HOST_IMPORT_BUFFER_READ, HOST_IMPORT_SPI_START,
+    HOST_IMPORT_SPI_STOP, HOST_IMPORT_PIN_READ,
+  };
+  fprintf(out, "%-15s %10s %12s %12s", "callback", "calls", "imports/call", "bytes/call");
+  for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+    fprintf(out, " %12s", import_names[columns[i]]);
+  }
+  fprintf(out, "\n");
+  for (uint32_t c = 0; c < HOST_CONTEXTS; c++) {
+    uint64_t calls = 0, bytes = 0;
+    for (uint32_t i = 0; i < HOST_IMPORT_COUNT; i++) {
+      calls += p->calls[i][c];
+      bytes += p->bytes[i][c];
+    }
+    if (calls == 0 && p->callbacks[c] == 0) {
+      continue;
+    }
+    char name[16], count[24] = "-";
+    double per = 1.0;
+    if (c != HOST_CONTEXT_HARNESS) {
+      snprintf(count, sizeof(count), "%llu", (unsigned long long)p->callbacks[c]);
+      per = p->callbacks[c] ? 1.0 / p->callbacks[c] : 0.0;
+    }
+    fprintf(out, "%-15s %10s %12.2f %12.1f", context_name(c, name, sizeof(name)), count, calls * per, bytes * per);
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+      fprintf(out, " %12.3f", p->calls[columns[i]][c] * per);
+    }
+    fprintf(out, "\n");
+  }
+}
+
+const host_stats_t *host_stats(void) {
+  return &host.stats;
+}
+
+/*-----------------------------------------------------------
+   Forget the chip and start over at time 0. The chip's own state
+   is not freed (the chip API has no teardown), only abandoned.
+-----------------------------------------------------------*/
+void host_reset(void) {
+  for (uint32_t i = 0; i < host.event_count; i++) {
+    free(host.events[i].data);
+  }
+  free(host.events);
+  for (uint32_t i = 0; i < host.spi_backlog_count; i++) {
+    free(host.spi_backlog[i].data);
+  }
+  free(host.spi_backlog);
+  free(host.framebuffer);
+  memset(&host, 0, sizeof(host));
+  host.spi_byte_ns = 8 * 1000000000ull / HOST_DEFAULT_SPI_CLOCK;
+}
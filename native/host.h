@@ -0,0 +1,129 @@
+// Native host for the GC9A01 chip
+//
+// host.c implements the wokwi-api.h imports, so chips/gc9a01.c links into
+// a plain Linux executable. The functions below are the simulator side:
+// they drive the chip's input pins, clock SPI bytes into it and move the
+// simulated clock.
+//
+// Time only moves when the harness asks for it: host_advance() and
+// host_run_until() process queued events (timer expiries, scheduled pin
+// edges and SPI chunks) in time order up to the new time, and every SPI
+// byte takes 8 clocks of the SPI bus (host_set_spi_clock, default 40 MHz).
+// Nothing ever waits for the wall clock.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef GC9A01_HOST_H
+#define GC9A01_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define HOST_DEFAULT_SPI_CLOCK  40000000   // Hz
+
+/*-----------------------------------------------------------
+   Host-side counters
+-----------------------------------------------------------*/
+typedef struct {
+  uint64_t buffer_writes;    // buffer_write() calls
+  uint64_t buffer_bytes;     // ... and the bytes they copied
+  uint64_t spi_chunks;       // SPI done callbacks
+  uint64_t spi_bytes;        // Bytes delivered to the chip
+  uint64_t spi_dropped;      // Bytes sent while the chip was not listening
+  uint64_t timer_callbacks;  // Chip timer callbacks fired
+  uint64_t events;           // Events processed (including stale timer expiries)
+  uint64_t import_calls;     // Calls into the host (boundary crossings), see host_print_profile
+  uint64_t frames;           // Chip callbacks that wrote the framebuffer: presentations
+                             // when the chip does not slice them (slice_pixels=0)
+} host_stats_t;
+
+/*-----------------------------------------------------------
+   Observer: sees what the chip sees, in the same order: every pin
+   change, and every SPI chunk as it is handed to the chip. present
+   is called after each chip callback that wrote the framebuffer,
+   which is once per frame only if the chip's slice_pixels is 0 (see
+   host_present_whole_frames). Any of them may be NULL.
+-----------------------------------------------------------*/
+typedef struct {
+  void (*pin)(const char *name, uint32_t value);
+  void (*spi)(const uint8_t *data, uint32_t count);
+  void (*present)(void);
+} host_observer_t;
+
+/* Set before chip_init() to override an attribute default; afterwards it
+   changes a live control. The name must stay valid. */
+void host_set_attr(const char *name, uint32_t value);
+
+/* Have the chip present each frame in one callback (slice_pixels=0),
+   so that host frames and the present hook see whole frames. Call it
+   before host_apply_attrs(), so that -a slice_pixels=N still slices. */
+void host_present_whole_frames(void);
+
+/* A tool's -a name=value argument (modified in place and kept): false
+   if it has no '=' or there are too many. host_apply_attrs() sets them
+   all; call it after host_reset() and the tool's own defaults, before
+   chip_init(). */
+bool host_parse_attr(char *arg);
+void host_apply_attrs(void);
+
+/* CPU time used by the process, for timing runs. */
+double host_cpu_seconds(void);
+
+void host_set_spi_clock(uint32_t hz);
+
+/* Where bytes the chip writes to its UART go (NULL = discard). */
+void host_set_uart_output(FILE *output);
+
+/* Drive an input pin, calling the chip's pin_change callback on a change. */
+void host_set_pin(const char *name, uint32_t value);
+uint32_t host_get_pin(const char *name);
+
+/* Clock bytes into the chip's SPI device. Bytes sent while another
+   transfer is clocking in (by a scheduled event) follow it on the bus. */
+void host_spi_send(const uint8_t *data, uint32_t count);
+
+/* Hand bytes to the chip as one SPI done callback, now (no bus time).
+   Returns the bytes that fit the chip's armed buffer. With hold, a
+   buffer they do not fill stays open for the chip's next spi_stop()
+   or host_spi_release() to complete. */
+uint32_t host_spi_deliver(const uint8_t *data, uint32_t count, bool hold);
+void host_spi_release(void);
+
+/* Process events up to (and including) time ns, or now + ns. */
+void host_run_until(uint64_t ns);
+void host_advance(uint64_t ns);
+
+/* Run the chip until any presentation in progress has finished, or
+   until done() (if not NULL) returns true. */
+void host_settle(bool (*done)(void));
+uint64_t host_now(void);
+
+/* Queue a pin edge or an SPI chunk (copied) for time at_ns. A chunk
+   starts clocking in at at_ns, or when the bus is free if a transfer
+   is still in flight, and takes its bus time from there. */
+void host_schedule_pin(uint64_t at_ns, const char *name, uint32_t value);
+void host_schedule_spi(uint64_t at_ns, const uint8_t *data, uint32_t count);
+
+/* The framebuffer as the simulator would show it (RGBA). */
+const uint32_t *host_framebuffer(uint32_t *width, uint32_t *height);
+uint32_t host_framebuffer_crc(void);
+
+/* CRC32 as zlib's crc32(): start with 0, pass the result back in to
+   continue over more data. */
+uint32_t host_crc32(uint32_t crc, const void *data, size_t len);
+
+void host_set_observer(const host_observer_t *observer);
+
+const host_stats_t *host_stats(void);
+
+/* Table of the chip's import calls and bytes (buffer_write, spi_start,
+   pin_read, ...) per presented frame and per callback: in the
+   simulator each one is a wasm boundary crossing. */
+void host_print_profile(FILE *out);
+
+/* Drop all pins, attributes, timers, events and counters, for running
+   chip_init() again in the same process. */
+void host_reset(void);
+
+#endif /* GC9A01_HOST_H */
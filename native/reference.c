@@ -0,0 +1,193 @@
+// Reference GC9A01 model for the differential checker
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "reference.h"
+
+#define REF_BLACK  0xff000000
+
+static struct {
+  uint32_t width;
+  uint32_t height;
+  uint32_t *framebuffer;
+
+  bool data_mode;
+  bool receiving_command;
+  uint8_t command;
+  uint8_t expected_args;
+  uint8_t received_args;
+  uint8_t args[16];
+  bool ram_write;
+  bool pending_valid;
+  uint8_t pending;
+
+  bool inverted;
+  uint16_t col_start, col_end, row_start, row_end;
+  uint32_t current_col, current_row;   // Wider, so an end of 0xffff still wraps
+} ref;
+
+static uint8_t arg_count(uint8_t command) {
+  switch (command) {
+    case 0x2A:   // CASET
+    case 0x2B:   // RASET
+      return 4;
+    case 0x36:   // MADCTL
+    case 0x3A:   // COLMOD
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static void reset(void) {
+  for (uint32_t i = 0; i < ref.width * ref.height; i++) {
+    ref.framebuffer[i] = REF_BLACK;
+  }
+  ref.inverted = false;
+  ref.ram_write = false;
+  ref.col_start = 0;
+  ref.col_end = ref.width - 1;
+  ref.row_start = 0;
+  ref.row_end = ref.height - 1;
+  ref.current_col = 0;
+  ref.current_row = 0;
+}
+
+void ref_init(uint32_t width, uint32_t height) {
+  free(ref.framebuffer);
+  memset(&ref, 0, sizeof(ref));
+  ref.width = width;
+  ref.height = height;
+  ref.framebuffer = calloc((size_t)width * height, sizeof(uint32_t));
+  if (!ref.framebuffer) {
+    fprintf(stderr, "reference: failed to allocate the framebuffer\n");
+    abort();
+  }
+  reset();
+}
+
+/*-----------------------------------------------------------
+   One RAMWR pixel: convert, invert, check the window, mask to the
+   circle, write, advance (wrapping inside the window).
+-----------------------------------------------------------*/
+static void process_pixel(uint16_t value) {
+  uint32_t color = 0xff000000 | ((value & 0x001F) << 19) | ((value & 0x07E0) << 5) | ((value & 0xF800) >> 8);
+  if (ref.inverted) {
+    uint8_t r = 255 - ((color >> 16) & 0xff);
+    uint8_t g = 255 - ((color >> 8) & 0xff);
+    uint8_t b = 255 - (color & 0xff);
+    color = 0xff000000 | (r << 16) | (g << 8) | b;
+  }
+
+  if (ref.current_col < ref.col_start || ref.current_col > ref.col_end ||
+      ref.current_row < ref.row_start || ref.current_row > ref.row_end) {
+    return;
+  }
+
+  // Off-panel pixels are dropped, which also keeps the mask test's
+  // squares within an int.
+  if (ref.current_col < ref.width && ref.current_row < ref.height) {
+    int center = ref.width / 2;
+    int dx = (int)ref.current_col - center;
+    int dy = (int)ref.current_row - center;
+    if (dx * dx + dy * dy > center * center) {
+      color = REF_BLACK;
+    }
+    ref.framebuffer[ref.current_row * ref.width + ref.current_col] = color;
+  }
+
+  ref.current_col++;
+  if (ref.current_col > ref.col_end) {
+    ref.current_col = ref.col_start;
+    ref.current_row++;
+    if (ref.current_row > ref.row_end) {
+      ref.current_row = ref.row_start;
+    }
+  }
+}
+
+static void process_command(void) {
+  const uint8_t *a = ref.args;
+  switch (ref.command) {
+    case 0x01:   // SWRESET
+      reset();
+      break;
+    case 0x2A:   // CASET
+      ref.col_start = (a[0] << 8) | a[1];
+      ref.col_end = (a[2] << 8) | a[3];
+      ref.current_col = ref.col_start;
+      break;
+    case 0x2B:   // RASET
+      ref.row_start = (a[0] << 8) | a[1];
+      ref.row_end = (a[2] << 8) | a[3];
+      ref.current_row = ref.row_start;
+      break;
+    case 0x2C:   // RAMWR
+      ref.ram_write = true;
+      ref.pending_valid = false;
+      break;
+    case 0x20:   // INVOFF
+      ref.inverted = false;
+      break;
+    case 0x21:   // INVON
+      ref.inverted = true;
+      break;
+    default:
+      break;
+  }
+  ref.receiving_command = false;
+}
+
+static void process_byte(uint8_t b) {
+  if (ref.receiving_command) {
+    ref.args[ref.received_args++] = b;
+    if (ref.received_args >= ref.expected_args) {
+      process_command();
+    }
+  } else if (!ref.data_mode) {
+    ref.ram_write = false;
+    ref.command = b;
+    ref.expected_args = arg_count(b);
+    ref.received_args = 0;
+    ref.receiving_command = true;
+    if (ref.expected_args == 0) {
+      process_command();
+    }
+  } else if (ref.ram_write) {
+    if (ref.pending_valid) {
+      ref.pending_valid = false;
+      process_pixel((ref.pending << 8) | b);
+    } else {
+      ref.pending = b;
+      ref.pending_valid = true;
+    }
+  }
+}
+
+void ref_spi(const uint8_t *data, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    process_byte(data[i]);
+  }
+}
+
+void ref_pin(const char *name, uint32_t value) {
+  if (strcmp(name, "CS") == 0) {
+    if (value) {
+      ref.ram_write = false;
+    }
+    ref.receiving_command = false;
+    ref.pending_valid = false;
+  } else if (strcmp(name, "DC") == 0) {
+    ref.data_mode = value;
+  } else if (strcmp(name, "RST") == 0 && !value) {
+    reset();
+  }
+}
+
+const uint32_t *ref_framebuffer(void) {
+  return ref.framebuffer;
+}
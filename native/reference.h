@@ -0,0 +1,25 @@
+// Reference GC9A01 model for the differential checker
+//
+// The chip's rendering semantics written the plain way: every SPI byte
+// is parsed on its own and every pixel goes through one process_pixel()
+// with the window check, circle mask and inversion done per pixel, as
+// in the original chip. No batching, span clipping, LUTs or SIMD, so it
+// is easy to trust; gc9a01-check compares the chip against it.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef GC9A01_REFERENCE_H
+#define GC9A01_REFERENCE_H
+
+#include <stdint.h>
+
+void ref_init(uint32_t width, uint32_t height);
+
+/* Feed what the chip sees (see host_observer_t). */
+void ref_pin(const char *name, uint32_t value);
+void ref_spi(const uint8_t *data, uint32_t count);
+
+/* RGBA, like the host framebuffer once the chip presented everything. */
+const uint32_t *ref_framebuffer(void);
+
+#endif /* GC9A01_REFERENCE_H */
@@ -0,0 +1,361 @@
+// GC9A01 parallel trace regression runner
+//
+//   gc9a01-regress [-v] [-a name=value]... [-j jobs] [-c chunk_bytes] [-b baseline] trace.bin...
+//
+// Replays every trace into its own fresh chip, jobs at a time (all cores
+// by default), and prints one report line per trace: a rolling CRC over
+// every presented frame, the final framebuffer CRC, presented frames as
+// counted by the host and by the chip, host counters and sim/CPU time.
+// With -b, the rolling CRCs are compared with a previous report and
+// changed or missing traces are flagged, so a change that is painted
+// over by the end of a trace still shows up.
+//
+// The chip runs with frame_crc=1; its frame lines give its own frame
+// count and framebuffer CRC, and a trace whose last chip CRC differs
+// from the host's framebuffer CRC is flagged as a mismatch.
+//
+// Rather than a work-stealing pool of threads, which the host's single
+// global simulated device rules out, each trace runs in its own forked
+// process: a chip instance per worker, and a trace that crashes the chip
+// only fails its own line. Traces are handed out largest first to
+// whichever worker frees up, so one long trace does not hold up the end
+// of the run. The chip's own output is only shown with -v.
+//
+// Exits with status 1 if any trace failed or changed.
+//
+// SPDX-License-Identifier: MIT
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "host.h"
+#include "trace.h"
+
+#define REGRESS_TAIL_NS    50000000ull   // Run on after the last record, as gc9a01-replay
+
+void chip_init(void);
+
+typedef enum {
+  REGRESS_PENDING,
+  REGRESS_OK,
+  REGRESS_BAD,       // Not a readable trace
+  REGRESS_CRASHED,   // The worker died
+  REGRESS_MISMATCH,  // The chip's frame CRC differs from the host's
+  REGRESS_CHANGED,   // Rolling CRC differs from the baseline
+  REGRESS_NEW,       // Not in the baseline
+} regress_status_t;
+
+static const char *const status_names[] = {
+  "pending", "ok", "bad", "crashed", "mismatch", "changed", "new",
+};
+
+/* One per trace, in memory shared with the workers */
+typedef struct {
+  regress_status_t status;
+  uint32_t frames_crc;       // Rolling CRC over every presented frame
+  uint32_t crc;              // Final framebuffer
+  uint64_t frames;
+  uint32_t chip_frames;      // From the chip's last frame line
+  uint32_t chip_crc;
+  bool chip_reported;
+  uint64_t records;
+  uint64_t spi_bytes;
+  uint64_t spi_chunks;
+  uint64_t buffer_writes;
+  uint64_t import_calls;
+  double sim_seconds;
+  double cpu_seconds;
+} regress_result_t;
+
+static uint32_t chunk_size;
+
+static double wall_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*-----------------------------------------------------------
+   Worker: replay one trace into a fresh chip and fill its result.
+-----------------------------------------------------------*/
+static uint32_t frames_crc;
+
+static void fold_frame(void) {
+  uint32_t width, height;
+  const uint32_t *framebuffer = host_framebuffer(&width, &height);
+  frames_crc = host_crc32(frames_crc, framebuffer, (size_t)width * height * 4);
+}
+
+// Pick the chip's frame count and CRC out of its output, and pass the
+// output on with -v.
+static void read_chip_output(FILE *output, bool verbose, regress_result_t *result) {
+  char line[256];
+  rewind(output);
+  while (fgets(line, sizeof(line), output)) {
+    unsigned frame, crc;
+    if (sscanf(line, "GC9A01 frame %u @%*fs: crc %x", &frame, &crc) == 2) {
+      result->chip_frames = frame;
+      result->chip_crc = crc;
+      result->chip_reported = true;
+    }
+    if (verbose) {
+      fputs(line, stdout);
+    }
+  }
+}
+
+static void replay(const char *path, regress_result_t *result, bool verbose) {
+  // The chip's output goes to a scratch file until the run is over.
+  FILE *output = tmpfile();
+  int report = dup(STDOUT_FILENO);
+  if (!output || report < 0) {
+    perror("gc9a01-regress");
+    return;
+  }
+  fflush(stdout);
+  dup2(fileno(output), STDOUT_FILENO);
+
+  host_present_whole_frames();
+  host_set_attr("frame_crc", 1);
+  host_apply_attrs();
+  const host_observer_t observer = {
+    .present = fold_frame,
+  };
+  host_set_observer(&observer);
+  chip_init();
+
+  trace_stats_t stats;
+  double start = host_cpu_seconds();
+  bool replayed = trace_replay(path, chunk_size, &stats);
+  if (replayed) {
+    // Finish a presentation the trace ended in the middle of, so that
+    // the framebuffer matches the chip's last frame even when sliced.
+    host_run_until(stats.end_ns + REGRESS_TAIL_NS);
+    host_settle(NULL);
+  }
+  double cpu = host_cpu_seconds() - start;
+
+  fflush(stdout);
+  dup2(report, STDOUT_FILENO);
+  close(report);
+  read_chip_output(output, verbose, result);
+  fclose(output);
+  if (!replayed) {
+    result->status = REGRESS_BAD;
+    return;
+  }
+
+  const host_stats_t *host = host_stats();
+  result->frames_crc = frames_crc;
+  result->crc = host_framebuffer_crc();
+  result->frames = host->frames;
+  result->records = stats.records;
+  result->spi_bytes = host->spi_bytes;
+  result->spi_chunks = host->spi_chunks;
+  result->buffer_writes = host->buffer_writes;
+  result->import_calls = host->import_calls;
+  result->sim_seconds = host_now() / 1e9;
+  result->cpu_seconds = cpu;
+  result->status = result->chip_reported && result->chip_crc != result->crc ? REGRESS_MISMATCH : REGRESS_OK;
+}
+
+/*-----------------------------------------------------------
+   Baseline: a previous report; lines are "frames_crc crc status ...
+   path".
+-----------------------------------------------------------*/
+static char **baseline_paths;
+static uint32_t *baseline_crcs;
+static uint32_t baseline_count;
+
+static bool load_baseline(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  char line[8192];
+  uint32_t capacity = 0;
+  while (fgets(line, sizeof(line), f)) {
+    unsigned crc;
+    char status[16];
+    int end = 0;
+    if (line[0] == '#' ||
+        sscanf(line, "%x %*x %15s %*s %*s %*s %*s %*s %*s %*s %*s %*s %n", &crc, status, &end) < 2 ||
+        end == 0) {
+      continue;
+    }
+    line[strcspn(line, "\n")] = '\0';
+    if (strcmp(status, "ok") != 0 && strcmp(status, "changed") != 0 && strcmp(status, "new") != 0) {
+      continue;
+    }
+    if (baseline_count == capacity) {
+      capacity = capacity ? capacity * 2 : 256;
+      baseline_paths = realloc(baseline_paths, capacity * sizeof(*baseline_paths));
+      baseline_crcs = realloc(baseline_crcs, capacity * sizeof(*baseline_crcs));
+      if (!baseline_paths || !baseline_crcs) {
+        fprintf(stderr, "gc9a01-regress: out of memory\n");
+        abort();
+      }
+    }
+    baseline_paths[baseline_count] = strdup(line + end);
+    baseline_crcs[baseline_count++] = crc;
+  }
+  fclose(f);
+  return true;
+}
+
+static void compare_baseline(const char *path, regress_result_t *result) {
+  if (result->status != REGRESS_OK) {
+    return;
+  }
+  for (uint32_t i = 0; i < baseline_count; i++) {
+    if (strcmp(baseline_paths[i], path) == 0) {
+      if (baseline_crcs[i] != result->frames_crc) {
+        result->status = REGRESS_CHANGED;
+      }
+      return;
+    }
+  }
+  result->status = REGRESS_NEW;
+}
+
+/*-----------------------------------------------------------
+   Scheduling: largest trace first, next one to the first free worker
+-----------------------------------------------------------*/
+static char **paths;
+static uint64_t *sizes;
+
+static int by_size(const void *a, const void *b) {
+  uint64_t sa = sizes[*(const uint32_t *)a], sb = sizes[*(const uint32_t *)b];
+  return sa < sb ? 1 : sa > sb ? -1 : 0;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: gc9a01-regress [-v] [-a name=value]... [-j jobs] [-c chunk_bytes] [-b baseline] trace.bin...\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *baseline = NULL;
+  bool verbose = false;
+  uint32_t count = 0;
+
+  paths = calloc(argc, sizeof(*paths));
+  sizes = calloc(argc, sizeof(*sizes));
+  if (!paths || !sizes) {
+    return 1;
+  }
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      if (!host_parse_attr(argv[++i])) {
+        usage();
+      }
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      jobs = strtol(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      chunk_size = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (argv[i][0] != '-') {
+      paths[count++] = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if (count == 0 || jobs < 1) {
+    usage();
+  }
+  if (baseline && !load_baseline(baseline)) {
+    return 1;
+  }
+
+  uint32_t *order = malloc(count * sizeof(*order));
+  regress_result_t *results = mmap(NULL, count * sizeof(*results), PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (!order || results == MAP_FAILED) {
+    perror("gc9a01-regress");
+    return 1;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    struct stat st;
+    sizes[i] = stat(paths[i], &st) == 0 ? (uint64_t)st.st_size : 0;
+    order[i] = i;
+  }
+  qsort(order, count, sizeof(*order), by_size);
+
+  fflush(stdout);
+  pid_t *workers = calloc(jobs, sizeof(*workers));
+  uint32_t *running = calloc(jobs, sizeof(*running));
+  if (!workers || !running) {
+    return 1;
+  }
+  double wall = wall_seconds();
+  uint32_t next = 0, active = 0;
+  while (next < count || active > 0) {
+    for (long w = 0; w < jobs && next < count; w++) {
+      if (workers[w] != 0) {
+        continue;
+      }
+      uint32_t trace = order[next++];
+      pid_t pid = fork();
+      if (pid == 0) {
+        replay(paths[trace], &results[trace], verbose);
+        fflush(stdout);
+        _exit(0);
+      } else if (pid < 0) {
+        perror("fork");
+        return 1;
+      }
+      workers[w] = pid;
+      running[w] = trace;
+      active++;
+    }
+
+    int wstatus;
+    pid_t done = wait(&wstatus);
+    if (done < 0) {
+      perror("wait");
+      return 1;
+    }
+    for (long w = 0; w < jobs; w++) {
+      if (workers[w] == done) {
+        regress_result_t *result = &results[running[w]];
+        if (result->status == REGRESS_PENDING || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+          result->status = REGRESS_CRASHED;
+        }
+        workers[w] = 0;
+        active--;
+      }
+    }
+  }
+  wall = wall_seconds() - wall;
+
+  printf("# rolling crc      status     frames chip_frames    records    spi_bytes   spi_done buffer_write    imports   sim_s   cpu_s path\n");
+  uint32_t failed = 0;
+  double cpu = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    regress_result_t *r = &results[i];
+    if (baseline) {
+      compare_baseline(paths[i], r);
+    }
+    failed += r->status != REGRESS_OK && r->status != REGRESS_NEW;
+    cpu += r->cpu_seconds;
+    printf("%08x %08x %-8s %8llu %11u %10llu %12llu %10llu %12llu %10llu %7.3f %7.3f %s\n",
+           r->frames_crc, r->crc, status_names[r->status], (unsigned long long)r->frames,
+           r->chip_frames, (unsigned long long)r->records, (unsigned long long)r->spi_bytes,
+           (unsigned long long)r->spi_chunks, (unsigned long long)r->buffer_writes,
+           (unsigned long long)r->import_calls, r->sim_seconds, r->cpu_seconds, paths[i]);
+  }
+  printf("# %u traces, %u failed or changed: %.3fs CPU in %.3fs with %ld jobs (%.1fx)\n",
+         count, failed, cpu, wall, jobs, wall > 0 ? cpu / wall : 0.0);
+  return failed ? 1 : 0;
+}
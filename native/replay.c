@@ -0,0 +1,105 @@
+// GC9A01 trace replayer
+//
+//   gc9a01-replay [-a name=value]... [-c chunk_bytes] [-p] [-d image] [-y video.y4m] trace.bin
+//
+// Feeds a trace (format in chips/gc9a01_trace.h, as streamed out of the
+// chip's TRACE pin or recorded with gc9a01-demo -t) to a fresh chip with
+// the original timing and chunk boundaries (see trace.h). -c re-chunks
+// the SPI bytes into chunks of chunk_bytes instead, to study callback
+// size sensitivity. -p prints the host import profile at the end. -d
+// and -y dump the framebuffer as with gc9a01-demo.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "dump.h"
+#include "trace.h"
+
+#define REPLAY_TAIL_NS  50000000ull   // Run on after the last record (50 ms)
+
+void chip_init(void);
+
+static void usage(void) {
+  fprintf(stderr, "usage: gc9a01-replay [-a name=value]... [-c chunk_bytes] [-p] [-d image] [-y video.y4m] trace.bin\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  uint32_t chunk_size = 0;
+  bool profile = false;
+  const char *image = NULL;
+  host_present_whole_frames();
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      if (!host_parse_attr(argv[++i])) {
+        usage();
+      }
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      chunk_size = strtoul(argv[++i], NULL, 0);
+      if (chunk_size == 0) {
+        usage();
+      }
+    } else if (strcmp(argv[i], "-p") == 0) {
+      profile = true;
+    } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      image = argv[++i];
+      if (strchr(image, '%') && !dump_frames(image)) {
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-y") == 0 && i + 1 < argc) {
+      if (!dump_video(argv[++i], DUMP_VIDEO_FPS)) {
+        return 1;
+      }
+    } else if (argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if (!path) {
+    usage();
+  }
+
+  const host_observer_t observer = {
+    .present = dump_present,
+  };
+  host_set_observer(&observer);
+  host_apply_attrs();
+  chip_init();
+
+  trace_stats_t stats;
+  double start = host_cpu_seconds();
+  if (!trace_replay(path, chunk_size, &stats)) {
+    return 1;
+  }
+  host_run_until(stats.end_ns + REPLAY_TAIL_NS);
+  double cpu = host_cpu_seconds() - start;
+  if (image && !strchr(image, '%')) {
+    dump_image(image);
+  }
+  dump_close();
+
+  const host_stats_t *host = host_stats();
+  double sim = host_now() / 1e9;
+  printf("%s: %llu records, %llu pin edges, %llu SPI chunks (%llu bytes)",
+         path, (unsigned long long)stats.records, (unsigned long long)stats.pin_records,
+         (unsigned long long)stats.spi_records, (unsigned long long)stats.spi_bytes);
+  if (stats.overflows > 0) {
+    printf(", %llu records lost in %llu overflows",
+           (unsigned long long)stats.lost_records, (unsigned long long)stats.overflows);
+  }
+  printf("\n");
+  printf("replayed %.3fs sim time in %.3fs CPU (%.0fx real time): %llu spi_done calls, "
+         "%llu bytes not received, %llu buffer_write calls\n",
+         sim, cpu, cpu > 0 ? sim / cpu : 0.0, (unsigned long long)host->spi_chunks,
+         (unsigned long long)stats.dropped_bytes, (unsigned long long)host->buffer_writes);
+  printf("framebuffer crc %08x\n", host_framebuffer_crc());
+  if (profile) {
+    host_print_profile(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,219 @@
+// Trace replay for the native harness
+//
+// SPDX-License-Identifier: MIT
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "host.h"
+#include "trace.h"
+#include "gc9a01_trace.h"
+
+#define TRACE_RELEASE_BYTES  (64u << 20)   // Release replayed pages every 64 MB
+
+static const char *const pin_names[3] = { "CS", "DC", "RST" };
+
+/* SPI bytes waiting to be re-chunked */
+static uint8_t *pending;
+static uint32_t pending_len;
+static uint32_t chunk_size;
+
+/* The last chunk was delivered held open: a pin edge at the same time
+   follows, whose spi_stop() completes it */
+static bool held;
+
+static void release(void) {
+  if (held) {
+    host_spi_release();
+    held = false;
+  }
+}
+
+static void deliver(trace_stats_t *stats, const uint8_t *data, uint32_t len, bool hold) {
+  release();
+  while (len > 0) {
+    uint32_t n = len;
+    if (chunk_size && n > chunk_size) {
+      n = chunk_size;
+    }
+    uint32_t taken = host_spi_deliver(data, n, hold && n == len);
+    if (taken == 0) {
+      stats->dropped_bytes += len;
+      return;
+    }
+    data += taken;
+    len -= taken;
+  }
+  held = hold;
+}
+
+static void flush_pending(trace_stats_t *stats, bool hold) {
+  if (pending_len > 0) {
+    deliver(stats, pending, pending_len, hold);
+    pending_len = 0;
+  }
+}
+
+static void add_pending(trace_stats_t *stats, const uint8_t *data, uint32_t len) {
+  while (len > 0) {
+    uint32_t n = chunk_size - pending_len < len ? chunk_size - pending_len : len;
+    memcpy(pending + pending_len, data, n);
+    pending_len += n;
+    data += n;
+    len -= n;
+    if (pending_len == chunk_size) {
+      flush_pending(stats, false);
+    }
+  }
+}
+
+/* Whether the record at p is a pin edge at the same time as the one
+   before it: the chip recorded an SPI chunk just before it from that
+   edge's spi_stop(). */
+static bool edge_follows(const uint8_t *p, const uint8_t *end) {
+  uint64_t delta;
+  if (p == end || (*p & 0xf0) != GC9A01_TRACE_PIN) {
+    return false;
+  }
+  p++;
+  return gc9a01_trace_get_varint(&p, end, &delta) && delta == 0;
+}
+
+/*-----------------------------------------------------------
+   Walk the records in order, running the host clock up to each
+   one's time before applying it. A chunk is held open until any
+   edge that stopped it, so each recorded SPI done callback replays
+   as one.
+-----------------------------------------------------------*/
+static bool play(const char *path, const uint8_t *map, size_t size, trace_stats_t *stats) {
+  const uint8_t *p = map + GC9A01_TRACE_HEADER_SIZE;
+  const uint8_t *end = map + size;
+  const uint8_t *released = map;
+  size_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+  uint64_t t = host_now();
+
+  while (p < end) {
+    const uint8_t *record = p;
+    uint8_t tag = *p++;
+    uint64_t delta;
+    if (!gc9a01_trace_get_varint(&p, end, &delta)) {
+      fprintf(stderr, "%s: truncated record at the end of the trace\n", path);
+      break;
+    }
+    t += delta;
+    stats->records++;
+
+    if ((tag & 0xf0) == GC9A01_TRACE_PIN) {
+      uint32_t pin = (tag >> 1) & 7;
+      if (pin > GC9A01_TRACE_PIN_RST) {
+        fprintf(stderr, "%s: bad pin record at offset %zu\n", path, (size_t)(record - map));
+        return false;
+      }
+      flush_pending(stats, delta == 0);
+      if (delta != 0) {
+        release();
+      }
+      host_run_until(t);
+      host_set_pin(pin_names[pin], tag & 1);
+      release();
+      stats->pin_records++;
+    } else if (tag == GC9A01_TRACE_SPI) {
+      uint64_t len;
+      if (!gc9a01_trace_get_varint(&p, end, &len) || len > (uint64_t)(end - p)) {
+        fprintf(stderr, "%s: truncated record at the end of the trace\n", path);
+        break;
+      }
+      if (delta != 0) {
+        release();
+      }
+      host_run_until(t);
+      if (chunk_size) {
+        add_pending(stats, p, len);
+      } else {
+        deliver(stats, p, len, edge_follows(p + len, end));
+      }
+      p += len;
+      stats->spi_records++;
+      stats->spi_bytes += len;
+    } else if (tag == GC9A01_TRACE_OVERFLOW) {
+      uint64_t lost;
+      if (!gc9a01_trace_get_varint(&p, end, &lost)) {
+        fprintf(stderr, "%s: truncated record at the end of the trace\n", path);
+        break;
+      }
+      if (stats->overflows++ == 0) {
+        fprintf(stderr, "%s: the trace lost records at %.6fs (UART overflow), replay will differ\n",
+                path, t / 1e9);
+      }
+      stats->lost_records += lost;
+    } else {
+      fprintf(stderr, "%s: bad record tag %02x at offset %zu\n", path, tag, (size_t)(record - map));
+      return false;
+    }
+
+    if ((size_t)(p - released) >= TRACE_RELEASE_BYTES) {
+      const uint8_t *upto = map + ((size_t)(p - map) & ~page_mask);
+      madvise((void *)released, upto - released, MADV_DONTNEED);
+      released = upto;
+    }
+  }
+  flush_pending(stats, false);
+  release();
+  stats->end_ns = t;
+  return true;
+}
+
+bool trace_replay(const char *path, uint32_t chunk_bytes, trace_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0) {
+    perror(path);
+    return false;
+  }
+  if (fstat(fd, &st) < 0) {
+    perror(path);
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  const uint8_t *map = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (map == MAP_FAILED || size < GC9A01_TRACE_HEADER_SIZE ||
+      memcmp(map, GC9A01_TRACE_MAGIC, GC9A01_TRACE_HEADER_SIZE - 1) != 0) {
+    fprintf(stderr, "%s: not a GC9A01 trace\n", path);
+    if (map != MAP_FAILED) {
+      munmap((void *)map, size);
+    }
+    return false;
+  }
+  if (map[GC9A01_TRACE_HEADER_SIZE - 1] != GC9A01_TRACE_VERSION) {
+    fprintf(stderr, "%s: trace version %u, expected %u\n", path,
+            map[GC9A01_TRACE_HEADER_SIZE - 1], GC9A01_TRACE_VERSION);
+    munmap((void *)map, size);
+    return false;
+  }
+  madvise((void *)map, size, MADV_SEQUENTIAL);
+
+  chunk_size = chunk_bytes;
+  pending_len = 0;
+  held = false;
+  if (chunk_size) {
+    pending = realloc(pending, chunk_size);
+    if (!pending) {
+      fprintf(stderr, "failed to allocate the chunk buffer\n");
+      munmap((void *)map, size);
+      return false;
+    }
+  }
+
+  bool ok = play(path, map, size, stats);
+  munmap((void *)map, size);
+  return ok;
+}
@@ -0,0 +1,35 @@
+// Trace replay for the native harness
+//
+// Walks a trace (format in chips/gc9a01_trace.h) and plays it into the
+// host: pin edges and SPI chunks arrive at their recorded times, and each
+// chunk reaches gc9a01_spi_done() with its original boundaries, or
+// re-chunked into chunk_size pieces between pin edges (capped by the
+// chip's SPI buffer) when chunk_size is not 0.
+//
+// The trace is mmapped and walked once; pages already replayed are
+// released, so traces much larger than memory replay fine.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef GC9A01_NATIVE_TRACE_H
+#define GC9A01_NATIVE_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+  uint64_t records;
+  uint64_t pin_records;
+  uint64_t spi_records;
+  uint64_t spi_bytes;
+  uint64_t overflows;       // Overflow records: the trace itself lost records
+  uint64_t lost_records;
+  uint64_t dropped_bytes;   // Bytes the chip was not listening for
+  uint64_t end_ns;          // Time of the last record
+} trace_stats_t;
+
+/* Replay the trace at path into the host (after chip_init()). Prints a
+   message and returns false if the file is not a readable trace. */
+bool trace_replay(const char *path, uint32_t chunk_size, trace_stats_t *stats);
+
+#endif /* GC9A01_NATIVE_TRACE_H */